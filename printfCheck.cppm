@@ -0,0 +1,89 @@
+
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2019 - 2024 Aitor Folgoso <aitor.folgoso@gmail.com>.
+
+/** *************************** **/
+/** FILE: printfCheck.cppm      **/
+/** *************************** **/
+
+// ----------------------------------------------------------
+//  C++20 named module with the checks of printfCheck.h.
+//  The macros can't be exported, the users import the module and
+//  include the header with PRINTF_CHECK_MODULE defined:
+//
+//      import printfCheck;
+//      #define PRINTF_CHECK_MODULE
+//      #include "printfCheck.h"
+//
+//  g++ -std=c++20 -fmodules-ts -x c++ -c printfCheck.cppm
+// ----------------------------------------------------------
+module;
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#ifdef ENABLE_TRACE_DEFERRED
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+#ifdef ENABLE_TRACE_SITES
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <time.h>
+#endif
+#if defined(ENABLE_PRINTF_PROFILE) || defined(ENABLE_PRINTF_LATENCY)
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+#ifdef ENABLE_FMT_VALIDATE
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#endif
+#ifdef ENABLE_PRINTF_LATENCY
+#include <chrono>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+#ifdef ENABLE_PRINTF_STRING
+#include <string>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+
+export module printfCheck;
+
+export
+{
+#include "printfCheck.h"
+}
@@ -0,0 +1,411 @@
+#!/usr/bin/env python3
+
+# Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+# SPDX-License-Identifier: MIT
+# Copyright (c) 2019 - 2024 Aitor Folgoso <aitor.folgoso@gmail.com>.
+
+# ----------------------------------------------------------
+#  printfCheck_bench.py
+#
+#  Compile-time cost of printfCheck.h: generates translation units with
+#  N printf()/TRACEPRINT() sites, compiles them with and without the
+#  checks and reports wall time, peak RSS, the time spent in template
+#  instantiation (clang -ftime-trace, gcc -ftime-report) and the object
+#  code size, which must be the same with and without the checks. The
+#  baseline TRACEPRINT() has the same runtime level check.
+#
+#  With --regression it builds printfCheck_main.cpp with the checks and
+#  with an empty PRINTF_CHECK() and a hand-written TRACEPRINT(), at -O0,
+#  -O2 and -Os, and exits non-zero on any difference of the sections or
+#  the symbols of the objects. With --nm it fails when the parser or the
+#  checks left a symbol in printfCheck_main.cpp at -O0, in C++17 and C++20.
+#  With --wformat it fails when an option that changes the calls, like
+#  ENABLE_PRINTF_STRING, hides a -Wformat diagnostic of the default build.
+#
+#  python3 printfCheck_bench.py
+#  python3 printfCheck_bench.py --sites 1000 --shapes 4x4 --modes nocheck,check
+#  python3 printfCheck_bench.py --opt=-O2
+#  python3 printfCheck_bench.py --regression
+#  python3 printfCheck_bench.py --nm
+#  python3 printfCheck_bench.py --wformat
+# ----------------------------------------------------------
+
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+REPO_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# mode -> extra compiler flags, 'nocheck' is the baseline
+MODES = {
+    "nocheck":    [],
+    "check":      ["-DWITH_PRINTF_CHECK"],
+    "float":      ["-DWITH_PRINTF_CHECK", "-DENABLE_CHECK_FLOATING"],
+    "novalidity": ["-DWITH_PRINTF_CHECK", "-DDISABLE_CHECK_FMT_FIELD_VALIDITY"],
+}
+
+# field kinds used to fill a fmt, the '%.*s' fields take two arguments
+FIELDS = [("%d", "i"), ("%s", "s"), ("%lu", "(unsigned long)i"), ("%x", "i")]
+STAR_FIELD = ("%.*s", "3, s")
+
+SITES_PER_FUNCTION = 100
+
+# --regression: the optimization levels, and the TRACE_LEVEL_COMPILED of
+# each build: the default, and every trace of printfCheck_main.cpp removed
+REGRESSION_OPTS    = ["-O0", "-O2", "-Os"]
+REGRESSION_CONFIGS = [[], ["-DTRACE_LEVEL_COMPILED=0"]]
+
+# --nm: the standards and the configs of printfCheck_main.cpp, and the
+# symbols of the compile-time parser and checks, all of them 'checkFmt*'.
+# Not ENABLE_FMT_VALIDATE, which checks the runtime fmts with them
+NM_STDS    = ["c++17", "c++20"]
+NM_CONFIGS = [[], ["-DENABLE_CHECK_FLOATING"], ["-DENABLE_PRINTF_STRING"],
+              ["-DENABLE_PRINTF_CONST"], ["-DENABLE_TRACE_SITES"]]
+NM_CHECK_SYMBOLS = re.compile(r"\b(parseFmtFields|checkFmt\w*|FmtFieldsOf)\b")
+
+# --wformat: the options that change how the calls are made. Not
+# ENABLE_TRACE_DEFERRED, whose TRACEPRINT() isn't a printf() call
+WFORMAT_CONFIGS = [["-DENABLE_PRINTF_STRING"], ["-DENABLE_PRINTF_CONST"],
+                   ["-DENABLE_PRINTF_STRING", "-DENABLE_PRINTF_CONST"],
+                   ["-DENABLE_PRINTF_PROFILE"], ["-DENABLE_PRINTF_LATENCY"], ["-DENABLE_TRACE_SITES"]]
+WFORMAT_DIAGNOSTIC = re.compile(r"\[-Wformat[=\]]")
+
+# the baseline of printfCheck_main.cpp: no checks, a hand-written 'if'
+BASELINE_MACROS = [
+    "#undef  PRINTF_CHECK",
+    "#define PRINTF_CHECK(...)                   do{ }while(0)",
+    "#undef  PRINTF_CHECK_BUFSIZE",
+    "#define PRINTF_CHECK_BUFSIZE(BUFSIZE, ...)  do{ }while(0)",
+    "#undef  TRACEPRINT",
+    "#define TRACEPRINT(index, level, ...)       "
+    "do{ if ((level) <= TRACE_LEVEL_COMPILED && printfcheck::isTraceLevelOn(level)) printf(__VA_ARGS__); }while(0)",
+    "",
+]
+
+
+def parse_shape(shape):
+    """'FxA': F fields consuming A arguments"""
+    fields, args = (int(v) for v in shape.split("x"))
+    if args < fields or args > 2 * fields:
+        raise argparse.ArgumentTypeError("shape %s: needs fields <= args <= 2*fields" % shape)
+    return fields, args
+
+
+def make_fmt(site, fields, args, unique):
+    stars = args - fields
+    parts = []
+    values = []
+    for i in range(fields):
+        fmt, value = STAR_FIELD if i < stars else FIELDS[i % len(FIELDS)]
+        parts.append(fmt)
+        values.append(value)
+
+    prefix = "site %d" % site if unique else "site"
+    return '"%s: %s \\n"' % (prefix, " ".join(parts)), values
+
+
+def generate_tu(path, sites, fields, args, unique):
+    lines = [
+        "#include <stdio.h>",
+        "#ifdef WITH_PRINTF_CHECK",
+        '#include "printfCheck.h"',
+        "#else",
+        "static int traceLevel = 0x7FFFFFFF;",
+        "#define TRACEPRINT(index, level, ...)  "
+        "do{ if ((level) <= __atomic_load_n(&traceLevel, __ATOMIC_RELAXED)) printf(__VA_ARGS__); }while(0)",
+        "#endif",
+        "",
+    ]
+
+    for site in range(sites):
+        if site % SITES_PER_FUNCTION == 0:
+            if site != 0:
+                lines.append("}")
+            lines.append("void traceSites%d(int i, const char* s)" % (site // SITES_PER_FUNCTION))
+            lines.append("{")
+
+        fmt, values = make_fmt(site, fields, args, unique)
+        call_args = ", ".join([fmt] + values)
+
+        if site % 2 == 0:
+            lines.append("    printf(%s);" % call_args)
+        else:
+            lines.append("    TRACEPRINT(1, 0xFF, %s);" % call_args)
+
+    if sites != 0:
+        lines.append("}")
+
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def generate_baseline_main(path):
+    """printfCheck_main.cpp with BASELINE_MACROS before its tests"""
+    with open(os.path.join(REPO_DIR, "printfCheck_main.cpp")) as f:
+        lines = f.read().split("\n")
+
+    # the tests start after the header, at their banner
+    tests = [i for i, line in enumerate(lines) if line.startswith("/**   TESTs")]
+    if not tests:
+        sys.exit("printfCheck_main.cpp: no TESTs banner")
+    lines[tests[0] - 1:tests[0] - 1] = BASELINE_MACROS
+
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def template_time_ms(compiler, obj, stderr):
+    """time spent instantiating templates, None when not available"""
+    if "clang" in compiler:
+        trace = os.path.splitext(obj)[0] + ".json"
+        if not os.path.exists(trace):
+            return None
+        with open(trace) as f:
+            events = json.load(f).get("traceEvents", [])
+        total = sum(e.get("dur", 0) for e in events
+                    if e.get("name") in ("Total InstantiateFunction", "Total InstantiateClass"))
+        return total / 1000.0
+
+    # gcc: ' template instantiation : usr ( %) sys ( %) wall ( %) ...'
+    for line in stderr.splitlines():
+        if line.strip().startswith("template instantiation"):
+            times = re.findall(r"([0-9.]+) \(\s*[0-9]+%\)", line)
+            if len(times) >= 3:
+                return float(times[2]) * 1000.0
+    return None
+
+
+def code_size(obj):
+    """bytes of .text + .data + .rodata + .bss, None without binutils 'size'"""
+    if shutil.which("size") is None:
+        return None
+    out = subprocess.run(["size", obj], capture_output=True, text=True).stdout.splitlines()
+    return int(out[1].split()[3]) if len(out) > 1 else None
+
+
+def object_footprint(compiler, std, opt, src, flags):
+    """{section: bytes} of 'size -A' and the 'nm' symbols, without addresses"""
+    obj = os.path.splitext(src)[0] + ".o"
+    cmd = [compiler, "-std=" + std, opt, "-w", "-I", REPO_DIR, "-c", src, "-o", obj] + flags
+    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    if proc.returncode != 0:
+        sys.exit("compilation failed: %s\n%s" % (" ".join(cmd), proc.stderr[-2000:]))
+
+    sections = {}
+    for line in subprocess.run(["size", "-A", obj], capture_output=True, text=True).stdout.splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[0].startswith(".") and fields[1].isdigit():
+            sections[fields[0]] = int(fields[1])
+
+    # ' U printf' and '0000000000000000 T main': the type and the name
+    symbols = set()
+    for line in subprocess.run(["nm", "-C", obj], capture_output=True, text=True).stdout.splitlines():
+        symbol = re.match(r"[0-9a-f]*\s+(\S) (.*)", line)
+        if symbol:
+            symbols.add(" ".join(symbol.groups()))
+    return sections, symbols
+
+
+def footprint_diff(base, check):
+    """the differences of two object_footprint(), empty when the same"""
+    (base_sections, base_symbols), (sections, symbols) = base, check
+    diff = ["%s %+d" % (name, sections.get(name, 0) - base_sections.get(name, 0))
+            for name in sorted(set(base_sections) | set(sections))
+            if sections.get(name, 0) != base_sections.get(name, 0)]
+    diff += ["+" + symbol for symbol in sorted(symbols - base_symbols)]
+    diff += ["-" + symbol for symbol in sorted(base_symbols - symbols)]
+    return diff
+
+
+def run_regression(compilers, std):
+    """0 when the checks add nothing to printfCheck_main.cpp, 1 otherwise"""
+    for tool in ("size", "nm"):
+        if shutil.which(tool) is None:
+            sys.exit("--regression needs binutils '%s'" % tool)
+
+    failed = False
+    workdir = tempfile.mkdtemp(prefix="printfCheck_regression_")
+    try:
+        checked  = os.path.join(workdir, "check.cpp")
+        baseline = os.path.join(workdir, "nocheck.cpp")
+        shutil.copy(os.path.join(REPO_DIR, "printfCheck_main.cpp"), checked)
+        generate_baseline_main(baseline)
+
+        for compiler in compilers:
+            for opt in REGRESSION_OPTS:
+                for flags in REGRESSION_CONFIGS:
+                    diff = footprint_diff(object_footprint(compiler, std, opt, baseline, flags),
+                                          object_footprint(compiler, std, opt, checked, flags))
+                    print("%-8s %-6s %-4s %-28s %s" % (compiler, std, opt, " ".join(flags) or "-",
+                                                       "REGRESSION" if diff else "same"), flush=True)
+                    for line in diff:
+                        print("    " + line)
+                    failed = failed or bool(diff)
+    finally:
+        shutil.rmtree(workdir)
+    return 1 if failed else 0
+
+
+def run_nm(compilers):
+    """0 when no parser or check symbol is left at -O0, 1 otherwise"""
+    if shutil.which("nm") is None:
+        sys.exit("--nm needs binutils 'nm'")
+
+    failed = False
+    workdir = tempfile.mkdtemp(prefix="printfCheck_nm_")
+    try:
+        src = os.path.join(workdir, "main.cpp")
+        shutil.copy(os.path.join(REPO_DIR, "printfCheck_main.cpp"), src)
+
+        for compiler in compilers:
+            for std in NM_STDS:
+                for flags in NM_CONFIGS:
+                    _, symbols = object_footprint(compiler, std, "-O0", src, flags)
+                    found = sorted(s for s in symbols if NM_CHECK_SYMBOLS.search(s))
+                    print("%-8s %-6s %-28s %s" % (compiler, std, " ".join(flags) or "-",
+                                                  "CHECK SYMBOLS" if found else "none"), flush=True)
+                    for symbol in found:
+                        print("    " + symbol)
+                    failed = failed or bool(found)
+    finally:
+        shutil.rmtree(workdir)
+    return 1 if failed else 0
+
+
+def count_wformat(compiler, std, src, flags):
+    """the -Wformat diagnostics of a build"""
+    obj = os.path.splitext(src)[0] + ".o"
+    cmd = [compiler, "-std=" + std, "-O0", "-pthread", "-Wformat", "-I", REPO_DIR, "-c", src, "-o", obj] + flags
+    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    if proc.returncode != 0:
+        sys.exit("compilation failed: %s\n%s" % (" ".join(cmd), proc.stderr[-2000:]))
+    return len([line for line in proc.stderr.splitlines() if WFORMAT_DIAGNOSTIC.search(line)])
+
+
+def run_wformat(compilers):
+    """0 when every option keeps the -Wformat diagnostics of the default build, 1 otherwise"""
+    failed = False
+    workdir = tempfile.mkdtemp(prefix="printfCheck_wformat_")
+    try:
+        src = os.path.join(workdir, "main.cpp")
+        shutil.copy(os.path.join(REPO_DIR, "printfCheck_main.cpp"), src)
+
+        for compiler in compilers:
+            for std in NM_STDS:
+                expected = count_wformat(compiler, std, src, [])
+                print("%-8s %-6s %-44s %d" % (compiler, std, "-", expected), flush=True)
+
+                for flags in WFORMAT_CONFIGS:
+                    count = count_wformat(compiler, std, src, flags)
+                    print("%-8s %-6s %-44s %d%s" % (compiler, std, " ".join(flags), count,
+                                                    "" if count == expected else " MISSING %d" % (expected - count)),
+                          flush=True)
+                    failed = failed or count != expected
+    finally:
+        shutil.rmtree(workdir)
+    return 1 if failed else 0
+
+
+def compile_tu(compiler, std, opt, tu, mode):
+    obj = os.path.splitext(tu)[0] + ".o"
+    cmd = [compiler, "-std=" + std, opt, "-w", "-I", REPO_DIR, "-c", tu, "-o", obj]
+    cmd += MODES[mode]
+    cmd += ["-ftime-trace"] if "clang" in compiler else ["-ftime-report"]
+
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    stderr = proc.stderr.read()
+    _, status, rusage = os.wait4(proc.pid, 0)
+    wall = time.perf_counter() - start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+
+    if proc.returncode != 0:
+        sys.exit("compilation failed: %s\n%s" % (" ".join(cmd), stderr[-2000:]))
+
+    # ru_maxrss is in KB on Linux
+    return wall, rusage.ru_maxrss / 1024.0, template_time_ms(compiler, obj, stderr), code_size(obj)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="compile-time cost of printfCheck.h")
+    parser.add_argument("--compilers", default=",".join(c for c in ("g++", "clang++") if shutil.which(c)))
+    parser.add_argument("--std",       default="c++17")
+    parser.add_argument("--opt",       default="-O0")
+    parser.add_argument("--sites",     default="100,1000,10000")
+    parser.add_argument("--shapes",    default="1x1,4x4,8x8,4x8", help="FIELDSxARGS list")
+    parser.add_argument("--modes",     default=",".join(MODES))
+    parser.add_argument("--shared-literals", action="store_true",
+                        help="every site uses the same fmt literal")
+    parser.add_argument("--output",    default=os.path.join(REPO_DIR, "bench_output.txt"))
+    parser.add_argument("--regression", action="store_true",
+                        help="fail when the checks change the code of printfCheck_main.cpp")
+    parser.add_argument("--nm",        action="store_true",
+                        help="fail when printfCheck_main.cpp has parser or check symbols at -O0")
+    parser.add_argument("--wformat",   action="store_true",
+                        help="fail when an option hides a -Wformat diagnostic of printfCheck_main.cpp")
+    opts = parser.parse_args()
+
+    compilers = [c for c in opts.compilers.split(",") if c]
+    if opts.regression:
+        sys.exit(run_regression(compilers, opts.std))
+    if opts.nm:
+        sys.exit(run_nm(compilers))
+    if opts.wformat:
+        sys.exit(run_wformat(compilers))
+
+    sites     = [int(s) for s in opts.sites.split(",")]
+    shapes    = [parse_shape(s) for s in opts.shapes.split(",")]
+    modes     = opts.modes.split(",")
+
+    for mode in modes:
+        if mode not in MODES:
+            sys.exit("unknown mode '%s', use: %s" % (mode, ", ".join(MODES)))
+    if "nocheck" not in modes:
+        modes.insert(0, "nocheck")
+
+    header = "%-8s %6s %6s %-10s %9s %9s %10s %8s %10s" % (
+        "compiler", "sites", "shape", "mode", "wall[s]", "rss[MB]", "inst[ms]", "vs base", "code[B]")
+    report = [header, "-" * len(header)]
+    print(header)
+
+    workdir = tempfile.mkdtemp(prefix="printfCheck_bench_")
+    try:
+        for compiler in compilers:
+            for nsites in sites:
+                for fields, args in shapes:
+                    tu = os.path.join(workdir, "tu_%d_%dx%d.cpp" % (nsites, fields, args))
+                    generate_tu(tu, nsites, fields, args, not opts.shared_literals)
+
+                    baseline = None
+                    base_code = None
+                    for mode in modes:
+                        wall, rss, inst, code = compile_tu(compiler, opts.std, opts.opt, tu, mode)
+                        if mode == "nocheck":
+                            baseline  = wall
+                            base_code = code
+
+                        # the checks must not add code: flag any difference with the baseline
+                        code_txt = "-" if code is None else "%d" % code
+                        if code is not None and base_code is not None and code != base_code:
+                            code_txt += " (%+d)" % (code - base_code)
+
+                        line = "%-8s %6d %6s %-10s %9.2f %9.1f %10s %7.2fx %10s" % (
+                            compiler, nsites, "%dx%d" % (fields, args), mode, wall, rss,
+                            "-" if inst is None else "%.0f" % inst, wall / baseline, code_txt)
+                        report.append(line)
+                        print(line, flush=True)
+    finally:
+        shutil.rmtree(workdir)
+
+    with open(opts.output, "w") as f:
+        f.write("\n".join(report) + "\n")
+
+
+if __name__ == "__main__":
+    main()
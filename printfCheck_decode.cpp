@@ -0,0 +1,711 @@
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2019 - 2024 Aitor Folgoso <aitor.folgoso@gmail.com>.
+
+/** *************************** **/
+/** FILE: printfCheck_decode.cpp **/
+/** *************************** **/
+
+/** *********************************************************************************
+//  printfcheck-decode: prints the binary traces written by
+//      printfcheck::startTraceConsumer(file, printfcheck::TraceOutput::Binary)
+//  the formats come from the "printfcheck_fmts" entries of the ELF files
+//  that traced, found by their ID.
+//
+//  g++ -std=c++17 -O2 -pthread printfCheck_decode.cpp -o printfcheck-decode
+//
+//  printfcheck-decode [-j threads] [-o output] trace.bin program [libraries...]
+//  printfcheck-decode --list program [libraries...]
+//  printfcheck-decode --check program [libraries...]
+//
+//  --check fails when different sites have the same ID, run it after
+//  the link: the entries of ENABLE_FMT_ID_TABLE and of the deferred
+//  TRACEPRINT() are checked
+*********************************************************************************** **/
+#define ENABLE_TRACE_DEFERRED
+#include "printfCheck.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+
+using namespace printfcheck;
+
+/** *****************************
+//  MappedFile
+//  read-only mmap of a whole file
+****************************** **/
+struct MappedFile
+{
+    const char* data = nullptr;
+    size_t      size = 0;
+
+    bool open(const char* path)
+    {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st = {};
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                data = (const char*)map;
+                size = (size_t)st.st_size;
+                madvise(map, size, MADV_SEQUENTIAL);
+            }
+        }
+
+        close(fd);
+        return data != nullptr;
+    }
+
+    ~MappedFile()
+    {
+        if (data != nullptr) munmap((void*)data, size);
+    }
+};
+
+/** *****************************
+//  TraceFormatEntry
+//  a format read from an ELF file, it points into the mapping
+****************************** **/
+struct TraceFormatEntry
+{
+    const TraceSectionHeader* header = nullptr;
+    const TraceArgInfo*       args   = nullptr;
+    const FmtFieldDesc*       fields = nullptr;
+    const char*               fmt    = nullptr;
+    const char*               file   = nullptr;
+};
+
+using TraceFormatMap = std::unordered_map<uint64_t, TraceFormatEntry>;
+
+/** *****************************
+//  FmtIdSite
+//  a PRINTF_CHECK() site of ENABLE_FMT_ID_TABLE
+****************************** **/
+struct FmtIdSite
+{
+    const FmtIdHeader* header = nullptr;
+    const char*        fmt    = nullptr;
+    const char*        file   = nullptr;
+};
+
+//  the entries of all the ELF files
+struct ElfEntries
+{
+    std::vector<TraceFormatEntry> formats;
+    std::vector<FmtIdSite>        sites;
+};
+
+//  an entry is accepted when its layout is consistent and its ID matches the fmt and the arguments
+bool
+readTraceFormatEntry(const char* data, size_t size, TraceFormatEntry& entry)
+{
+    const TraceSectionHeader Magic = {};
+
+    if (size < sizeof(TraceSectionHeader) || memcmp(data, Magic.magic, sizeof(Magic.magic)) != 0)
+        return false;
+
+    TraceSectionHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    TraceSectionLayout layout = getTraceSectionLayout(header.argCount, header.fieldCount, header.fmtSize, header.fileSize);
+
+    if (header.fmtSize == 0 || header.fileSize == 0 || layout.size != header.entrySize || layout.size > size)
+        return false;
+
+    entry.header = (const TraceSectionHeader*)data;
+    entry.args   = (const TraceArgInfo*)(data + layout.args);
+    entry.fields = (const FmtFieldDesc*)(data + layout.fields);
+    entry.fmt    = data + layout.fmt;
+    entry.file   = data + layout.file;
+
+    if (entry.fmt[header.fmtSize - 1] != '\0' || entry.file[header.fileSize - 1] != '\0')
+        return false;
+
+    uint64_t siteId = makeFmtId(std::string_view(entry.fmt, header.fmtSize - 1), std::string_view(entry.file, header.fileSize - 1),
+                                header.line, (header.flags & FmtIdFileLine) != 0);
+
+    return getTraceFormatId(siteId, entry.args, header.argCount) == header.id;
+}
+
+bool
+readFmtIdEntry(const char* data, size_t size, FmtIdSite& site)
+{
+    const FmtIdHeader Magic = {};
+
+    if (size < sizeof(FmtIdHeader) || memcmp(data, Magic.magic, sizeof(Magic.magic)) != 0)
+        return false;
+
+    FmtIdHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    if (header.fmtSize == 0 || header.fileSize == 0 || getFmtIdEntrySize(header.fmtSize, header.fileSize) > size)
+        return false;
+
+    site.header = (const FmtIdHeader*)data;
+    site.fmt    = data + sizeof(FmtIdHeader);
+    site.file   = site.fmt + header.fmtSize;
+
+    if (site.fmt[header.fmtSize - 1] != '\0' || site.file[header.fileSize - 1] != '\0')
+        return false;
+
+    return makeFmtId(std::string_view(site.fmt, header.fmtSize - 1), std::string_view(site.file, header.fileSize - 1),
+                     header.line, (header.flags & FmtIdFileLine) != 0) == header.id;
+}
+
+/** *****************************
+//  readElfEntries()
+//  the entries are 8 bytes aligned in the allocated data sections: in
+//  "printfcheck_fmts" and "printfcheck_ids" with clang, in .rodata with
+//  GCC. Also works with the object files
+****************************** **/
+bool
+readElfEntries(const MappedFile& elf, const char* path, ElfEntries& entries)
+{
+    const char* data = elf.data;
+
+    if (elf.size < sizeof(Elf64_Ehdr) || memcmp(data, ELFMAG, SELFMAG) != 0 || data[EI_CLASS] != ELFCLASS64)
+    {
+        fprintf(stderr, "%s: not a 64-bit ELF file\n", path);
+        return false;
+    }
+
+    Elf64_Ehdr ehdr;
+    memcpy(&ehdr, data, sizeof(ehdr));
+
+    if (ehdr.e_shoff == 0 || ehdr.e_shoff + (size_t)ehdr.e_shnum * sizeof(Elf64_Shdr) > elf.size)
+    {
+        fprintf(stderr, "%s: no section headers\n", path);
+        return false;
+    }
+
+    const Elf64_Shdr* sections = (const Elf64_Shdr*)(data + ehdr.e_shoff);
+
+    for(uint32_t i = 0; i < ehdr.e_shnum; i++)
+    {
+        const Elf64_Shdr& section = sections[i];
+
+        if (section.sh_type != SHT_PROGBITS || section.sh_offset + section.sh_size > elf.size ||
+            (section.sh_flags & SHF_ALLOC) == 0 || (section.sh_flags & SHF_EXECINSTR) != 0)
+            continue;
+
+        const char* start = data + section.sh_offset;
+        size_t      first = (8 - section.sh_addr % 8) % 8;
+
+        for(size_t offset = first; offset + sizeof(FmtIdHeader) <= section.sh_size; )
+        {
+            TraceFormatEntry format;
+            FmtIdSite        site;
+
+            if (readTraceFormatEntry(start + offset, section.sh_size - offset, format) == true)
+            {
+                entries.formats.push_back(format);
+                offset += format.header->entrySize;
+            }
+            else if (readFmtIdEntry(start + offset, section.sh_size - offset, site) == true)
+            {
+                entries.sites.push_back(site);
+                offset += getFmtIdEntrySize(site.header->fmtSize, site.header->fileSize);
+            }
+            else
+            {
+                offset += 8;
+            }
+        }
+    }
+
+    return true;
+}
+
+/** *****************************
+//  checkIdCollisions()
+//  the same ID for different sites: another fmt or other arguments, or
+//  another file or line when they are in the ID. The same site can be
+//  in several entries, one per translation unit or template instance
+****************************** **/
+size_t
+checkIdCollisions(const ElfEntries& entries)
+{
+    size_t collisions = 0;
+
+    std::unordered_map<uint64_t, const FmtIdSite*> sites;
+    for(const FmtIdSite& site : entries.sites)
+    {
+        auto [found, isNew] = sites.emplace(site.header->id, &site);
+        if (isNew == true) continue;
+
+        const FmtIdSite& other     = *found->second;
+        bool             fileLine  = (site.header->flags & FmtIdFileLine) != 0;
+        bool             isSameFmt = strcmp(site.fmt, other.fmt) == 0;
+
+        if (isSameFmt == false || (fileLine == true && (strcmp(site.file, other.file) != 0 || site.header->line != other.header->line)))
+        {
+            fprintf(stderr, "ID %016llx collision: %s:%u \"%s\" and %s:%u \"%s\"\n", (unsigned long long)site.header->id,
+                    other.file, other.header->line, other.fmt, site.file, site.header->line, site.fmt);
+            collisions++;
+        }
+    }
+
+    std::unordered_map<uint64_t, const TraceFormatEntry*> formats;
+    for(const TraceFormatEntry& format : entries.formats)
+    {
+        auto [found, isNew] = formats.emplace(format.header->id, &format);
+        if (isNew == true) continue;
+
+        const TraceFormatEntry& other    = *found->second;
+        bool                    fileLine = (format.header->flags & FmtIdFileLine) != 0;
+        uint32_t                argCount = format.header->argCount;
+
+        bool isSame = strcmp(format.fmt, other.fmt) == 0 && argCount == other.header->argCount &&
+                      memcmp(format.args, other.args, argCount * sizeof(TraceArgInfo)) == 0;
+
+        if (isSame == false || (fileLine == true && (strcmp(format.file, other.file) != 0 || format.header->line != other.header->line)))
+        {
+            fprintf(stderr, "trace ID %016llx collision: %s:%u \"%s\" and %s:%u \"%s\"\n", (unsigned long long)format.header->id,
+                    other.file, other.header->line, other.fmt, format.file, format.header->line, format.fmt);
+            collisions++;
+        }
+    }
+
+    return collisions;
+}
+
+/** *****************************
+//  TraceValue
+//  an argument read from a record, with the type it was traced with
+****************************** **/
+struct TraceValue
+{
+    TraceArgType type     = TraceArgType::Other;
+    int64_t      integer  = 0;
+    long double  floating = 0;
+    const char*  string   = nullptr;
+};
+
+//  nullptr when the record is too short
+const char*
+readTraceValue(const char* in, const char* end, const TraceArgInfo& info, TraceValue& value)
+{
+    value.type = info.type;
+
+    if (info.type == TraceArgType::String)
+    {
+        uint32_t length = 0;
+        if (end - in < (std::ptrdiff_t)sizeof(uint32_t)) return nullptr;
+        memcpy(&length, in, sizeof(uint32_t));
+        in += sizeof(uint32_t);
+
+        if (length == TraceStringNull)
+        {
+            value.string = nullptr;
+            return in;
+        }
+
+        if ((uint64_t)(end - in) < (uint64_t)length + 1) return nullptr;
+        value.string = in;
+        return in + length + 1;
+    }
+
+    if (end - in < info.size || info.size > sizeof(long double)) return nullptr;
+
+    if (info.type == TraceArgType::Floating)
+    {
+        if      (info.size == sizeof(float))  { float  v; memcpy(&v, in, sizeof(v)); value.floating = v; }
+        else if (info.size == sizeof(double)) { double v; memcpy(&v, in, sizeof(v)); value.floating = v; }
+        else                                  { memcpy(&value.floating, in, sizeof(long double)); }
+    }
+    else if (info.size <= sizeof(uint64_t))
+    {
+        uint64_t bits = 0;
+        memcpy(&bits, in, info.size);       // little endian
+
+        // sign extension of the smaller types
+        if (info.type == TraceArgType::Signed && info.size < sizeof(uint64_t) && (bits >> (info.size * 8 - 1)) != 0)
+            bits |= ~(uint64_t)0 << (info.size * 8);
+
+        value.integer = (int64_t)bits;
+    }
+
+    return in + info.size;
+}
+
+/** *****************************
+//  formatTraceField()
+//  a field printed with snprintf() and its own spec: the value is
+//  converted to the type the conversion and its length expect
+****************************** **/
+template<typename... Stars>
+int
+formatTraceFieldValue(char* out, size_t size, const char* spec, const FmtFieldDesc& field, const TraceValue& value, Stars... stars)
+{
+    // runtime specs from the ELF file, checked when they were traced
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wformat-nonliteral"
+    #pragma GCC diagnostic ignored "-Wformat-security"
+
+    int64_t     integer = value.type == TraceArgType::Floating ? (int64_t)value.floating : value.integer;
+    long double real    = value.type == TraceArgType::Floating ? value.floating          : (long double)value.integer;
+
+    switch(field.conversion)
+    {
+    case 'd': case 'i':
+        switch(field.length)
+        {
+        case FmtLength::hh: return (snprintf)(out, size, spec, stars..., (int)(signed char)integer);
+        case FmtLength::h:  return (snprintf)(out, size, spec, stars..., (int)(short)integer);
+        case FmtLength::l:  return (snprintf)(out, size, spec, stars..., (long)integer);
+        case FmtLength::ll: return (snprintf)(out, size, spec, stars..., (long long)integer);
+        case FmtLength::j:  return (snprintf)(out, size, spec, stars..., (intmax_t)integer);
+        case FmtLength::z:  return (snprintf)(out, size, spec, stars..., (std::ptrdiff_t)integer);
+        case FmtLength::t:  return (snprintf)(out, size, spec, stars..., (std::ptrdiff_t)integer);
+        default:            return (snprintf)(out, size, spec, stars..., (int)integer);
+        }
+
+    case 'u': case 'o': case 'x': case 'X':
+        switch(field.length)
+        {
+        case FmtLength::hh: return (snprintf)(out, size, spec, stars..., (unsigned)(unsigned char)integer);
+        case FmtLength::h:  return (snprintf)(out, size, spec, stars..., (unsigned)(unsigned short)integer);
+        case FmtLength::l:  return (snprintf)(out, size, spec, stars..., (unsigned long)integer);
+        case FmtLength::ll: return (snprintf)(out, size, spec, stars..., (unsigned long long)integer);
+        case FmtLength::j:  return (snprintf)(out, size, spec, stars..., (uintmax_t)integer);
+        case FmtLength::z:  return (snprintf)(out, size, spec, stars..., (size_t)integer);
+        case FmtLength::t:  return (snprintf)(out, size, spec, stars..., (size_t)integer);
+        default:            return (snprintf)(out, size, spec, stars..., (unsigned)integer);
+        }
+
+    case 'c':
+        return (snprintf)(out, size, spec, stars..., (int)integer);
+
+    case 's':
+        return (snprintf)(out, size, spec, stars..., value.type == TraceArgType::String ? value.string : "");
+
+    case 'p':
+        return (snprintf)(out, size, spec, stars..., (void*)(uintptr_t)integer);
+
+    default:
+        if (field.length == FmtLength::L)
+            return (snprintf)(out, size, spec, stars..., real);
+        return (snprintf)(out, size, spec, stars..., (double)real);
+    }
+
+    #pragma GCC diagnostic pop
+}
+
+//  nullptr when the record doesn't match the format
+const char*
+formatTraceField(std::string& out, const TraceFormatEntry& entry, const FmtFieldDesc& field, const char* in, const char* end, uint32_t& argIndex)
+{
+    int        stars[2] = {};
+    TraceValue value;
+
+    for(uint32_t i = 0; i < field.starCount && i < 2; i++)
+    {
+        if (argIndex >= entry.header->argCount || (in = readTraceValue(in, end, entry.args[argIndex++], value)) == nullptr)
+            return nullptr;
+        stars[i] = (int)value.integer;
+    }
+
+    if (argIndex >= entry.header->argCount || (in = readTraceValue(in, end, entry.args[argIndex++], value)) == nullptr)
+        return nullptr;
+
+    char spec[64];
+    if (field.size >= sizeof(spec)) return nullptr;
+    memcpy(spec, entry.fmt + field.offset, field.size);
+    spec[field.size] = '\0';
+
+    char   buffer[256];
+    int    size   = 0;
+    size_t offset = out.size();
+
+    for(int pass = 0; pass < 2; pass++)
+    {
+        char*  dest     = pass == 0 ? buffer         : &out[offset];
+        size_t destSize = pass == 0 ? sizeof(buffer) : (size_t)size + 1;
+
+        if      (field.starCount == 0) size = formatTraceFieldValue(dest, destSize, spec, field, value);
+        else if (field.starCount == 1) size = formatTraceFieldValue(dest, destSize, spec, field, value, stars[0]);
+        else                           size = formatTraceFieldValue(dest, destSize, spec, field, value, stars[0], stars[1]);
+
+        if (size < 0) return nullptr;
+
+        if (pass == 0 && (size_t)size < sizeof(buffer))
+        {
+            out.append(buffer, (size_t)size);
+            break;
+        }
+
+        // too long for the buffer: formatted again in place
+        if (pass == 0) out.resize(offset + (size_t)size + 1);
+        else           out.resize(offset + (size_t)size);
+    }
+
+    return in;
+}
+
+//  the text between the fields, '%%' is a single '%'
+void
+appendTraceText(std::string& out, const char* text, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        out += text[i];
+        if (text[i] == '%' && i + 1 < size && text[i + 1] == '%') i++;
+    }
+}
+
+/** *****************************
+//  decodeTraceRecord()
+****************************** **/
+void
+decodeTraceRecord(std::string& out, const TraceFormatMap& formats, const TraceFileRecordHeader& header, const char* args, const char* end)
+{
+    auto found = formats.find(header.id);
+    if (found == formats.end())
+    {
+        char line[64];
+        int  size = (snprintf)(line, sizeof(line), "<unknown format %016llx>\n", (unsigned long long)header.id);
+        out.append(line, (size_t)size);
+        return;
+    }
+
+    const TraceFormatEntry& entry = found->second;
+    const char*             in    = args;
+    uint32_t                text  = 0;
+    uint32_t                arg   = 0;
+
+    for(uint32_t i = 0; i < entry.header->fieldCount && in != nullptr; i++)
+    {
+        const FmtFieldDesc& field = entry.fields[i];
+
+        appendTraceText(out, entry.fmt + text, field.offset - text);
+        in   = formatTraceField(out, entry, field, in, end, arg);
+        text = field.offset + field.size;
+    }
+
+    if (in == nullptr)
+    {
+        out += "<bad record>\n";
+        return;
+    }
+
+    appendTraceText(out, entry.fmt + text, entry.header->fmtSize - 1 - text);
+}
+
+/** *****************************
+//  decodeTraces()
+//  the record boundaries are found first, then every thread decodes a
+//  chunk of records into its own buffer and the buffers are written in
+//  order. The input is processed in windows to bound the memory
+****************************** **/
+struct TraceChunk
+{
+    size_t      begin = 0;
+    size_t      end   = 0;
+    std::string out;
+};
+
+size_t
+decodeTraceChunk(const MappedFile& trace, const TraceFormatMap& formats, TraceChunk& chunk)
+{
+    size_t count = 0;
+
+    chunk.out.clear();
+
+    for(size_t offset = chunk.begin; offset < chunk.end; count++)
+    {
+        TraceFileRecordHeader header;
+        memcpy(&header, trace.data + offset, sizeof(header));
+
+        decodeTraceRecord(chunk.out, formats, header, trace.data + offset + sizeof(header), trace.data + offset + header.size);
+        offset += header.size;
+    }
+
+    return count;
+}
+
+bool
+decodeTraces(const MappedFile& trace, const TraceFormatMap& formats, FILE* output, uint32_t threadCount)
+{
+    constexpr size_t ChunkSize = 8 << 20;
+
+    const TraceFileHeader Magic = {};
+    TraceFileHeader       fileHeader;
+
+    if (trace.size < sizeof(fileHeader) || memcmp(trace.data, Magic.magic, sizeof(Magic.magic)) != 0)
+    {
+        fprintf(stderr, "not a binary trace file\n");
+        return false;
+    }
+
+    memcpy(&fileHeader, trace.data, sizeof(fileHeader));
+    if (fileHeader.version != Magic.version)
+    {
+        fprintf(stderr, "trace file version %u, expected %u\n", fileHeader.version, Magic.version);
+        return false;
+    }
+
+    std::vector<TraceChunk> chunks(threadCount);
+    size_t                  offset      = sizeof(fileHeader);
+    size_t                  count       = 0;
+    bool                    isTruncated = false;
+
+    while(offset < trace.size && isTruncated == false)
+    {
+        // the chunks of this window, split at record boundaries
+        uint32_t used = 0;
+        for(; used < threadCount && offset < trace.size; used++)
+        {
+            TraceChunk& chunk = chunks[used];
+            chunk.begin = offset;
+
+            while(offset < trace.size && offset - chunk.begin < ChunkSize)
+            {
+                TraceFileRecordHeader header;
+
+                if (trace.size - offset < sizeof(header)) break;
+                memcpy(&header, trace.data + offset, sizeof(header));
+                if (header.size < sizeof(header) || header.size > trace.size - offset) break;
+
+                offset += header.size;
+            }
+
+            chunk.end = offset;
+            if (chunk.end == chunk.begin)
+            {
+                isTruncated = true;
+                break;
+            }
+        }
+
+        std::vector<std::thread> threads;
+        std::vector<size_t>      counts(used);
+
+        for(uint32_t i = 1; i < used; i++)
+            threads.emplace_back([&, i]() { counts[i] = decodeTraceChunk(trace, formats, chunks[i]); });
+
+        if (used > 0) counts[0] = decodeTraceChunk(trace, formats, chunks[0]);
+
+        for(auto& thread : threads) thread.join();
+
+        for(uint32_t i = 0; i < used; i++)
+        {
+            fwrite(chunks[i].out.data(), 1, chunks[i].out.size(), output);
+            count += counts[i];
+        }
+    }
+
+    if (isTruncated == true)
+        fprintf(stderr, "truncated trace file: %zu bytes left\n", (size_t)(trace.size - offset));
+
+    fprintf(stderr, "%zu records\n", count);
+    return true;
+}
+
+/** *****************************
+//  main()
+****************************** **/
+int
+usage()
+{
+    fprintf(stderr, "usage: printfcheck-decode [-j threads] [-o output] trace.bin program [libraries...]\n"
+                    "       printfcheck-decode --list program [libraries...]\n"
+                    "       printfcheck-decode --check program [libraries...]\n");
+    return 2;
+}
+
+int
+main(int argc, char** argv)
+{
+    uint32_t    threadCount = 1;
+    const char* outputPath  = nullptr;
+    bool        isList      = false;
+    bool        isCheck     = false;
+    int         index       = 1;
+
+    for(; index < argc && argv[index][0] == '-'; index++)
+    {
+        std::string_view option = argv[index];
+
+        if      (option == "--list")                    isList      = true;
+        else if (option == "--check")                   isCheck     = true;
+        else if (option == "-j" && index + 1 < argc)    threadCount = (uint32_t)std::max(1, atoi(argv[++index]));
+        else if (option == "-o" && index + 1 < argc)    outputPath  = argv[++index];
+        else                                            return usage();
+    }
+
+    bool isTrace = isList == false && isCheck == false;
+
+    if (argc - index < (isTrace == true ? 2 : 1)) return usage();
+
+    const char* tracePath = isTrace == true ? argv[index++] : nullptr;
+
+    // the entries point into the mappings, they're kept until the end
+    std::vector<std::unique_ptr<MappedFile>> elfs;
+    ElfEntries                               entries;
+
+    for(; index < argc; index++)
+    {
+        elfs.push_back(std::make_unique<MappedFile>());
+
+        if (elfs.back()->open(argv[index]) == false)
+        {
+            fprintf(stderr, "%s: can't be read\n", argv[index]);
+            return 1;
+        }
+
+        if (readElfEntries(*elfs.back(), argv[index], entries) == false) return 1;
+    }
+
+    if (isList == true)
+    {
+        for(const FmtIdSite& site : entries.sites)
+            fprintf(stdout, "%016llx %s:%u \"%s\"\n", (unsigned long long)site.header->id, site.file, site.header->line, site.fmt);
+        for(const TraceFormatEntry& format : entries.formats)
+            fprintf(stdout, "%016llx %s:%u \"%s\" trace\n", (unsigned long long)format.header->id, format.file, format.header->line, format.fmt);
+    }
+
+    if (isCheck == true)
+    {
+        size_t collisions = checkIdCollisions(entries);
+
+        fprintf(stderr, "%zu IDs, %zu trace IDs, %zu collisions\n", entries.sites.size(), entries.formats.size(), collisions);
+        return collisions == 0 ? 0 : 1;
+    }
+
+    if (isTrace == false) return 0;
+
+    TraceFormatMap formats;
+    for(const TraceFormatEntry& format : entries.formats)
+        formats.emplace(format.header->id, format);
+
+    MappedFile trace;
+    if (trace.open(tracePath) == false)
+    {
+        fprintf(stderr, "%s: can't be read\n", tracePath);
+        return 1;
+    }
+
+    FILE* output = outputPath != nullptr ? fopen(outputPath, "wb") : stdout;
+    if (output == nullptr)
+    {
+        fprintf(stderr, "%s: can't be written\n", outputPath);
+        return 1;
+    }
+
+    bool isDecoded = decodeTraces(trace, formats, output, threadCount);
+
+    if (output != stdout) fclose(output);
+
+    return isDecoded == true ? 0 : 1;
+}
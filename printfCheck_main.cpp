@@ -21,10 +21,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#include <string>
-#include <string_view>
-#include <tuple>
-#include <type_traits>
+#include <cstdio>        // it #undef's printf(), must be included before the macros
 #include <stdint.h>
 #include <stdio.h>
 
@@ -32,38 +29,167 @@
 /** FILE: printfCheck_main.cpp  **/
 /** *************************** **/
 
+/** *********************************************************************************
+//  C++20 module: printfCheck.cppm exports everything but the macros. To use it
+//      import printfCheck;
+//      #define PRINTF_CHECK_MODULE
+//      #include "printfCheck.h"
+//  only the macros are defined then, the rest comes from the module
+*********************************************************************************** **/
+// the latencies are counted by the profile
+#if defined(ENABLE_PRINTF_LATENCY) && !defined(ENABLE_PRINTF_PROFILE)
+#define ENABLE_PRINTF_PROFILE
+#endif
+
+#ifndef PRINTF_CHECK_MODULE
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#ifdef ENABLE_TRACE_DEFERRED
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+#ifdef ENABLE_TRACE_SITES
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <time.h>
+#endif
+#ifdef ENABLE_PRINTF_PROFILE
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+#ifdef ENABLE_FMT_VALIDATE
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#endif
+#ifdef ENABLE_PRINTF_LATENCY
+#include <chrono>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+#ifdef ENABLE_PRINTF_STRING
+#include <string>
+#endif
+#endif
+
 // ----------------------------------------------------------
 // set/unset flags
 // ----------------------------------------------------------
-constexpr bool EnableWarningTooMuchArguments = true;
-constexpr bool DisableFmtFieldValidity       = false;
+#ifndef PRINTF_CHECK_MODULE
+inline constexpr bool EnableWarningTooMuchArguments = true;
+#ifdef DISABLE_CHECK_FMT_FIELD_VALIDITY
+inline constexpr bool DisableFmtFieldValidity       = true;
+#else
+inline constexpr bool DisableFmtFieldValidity       = false;
+#endif
 #ifdef ENABLE_CHECK_FLOATING
-constexpr bool EnableFloatingCheck           = true;
+inline constexpr bool EnableFloatingCheck           = true;
+#else
+inline constexpr bool EnableFloatingCheck           = false;
+#endif
+#ifdef DISABLE_CHECK_BUFFER_SIZE
+inline constexpr bool DisableBufferSizeCheck        = true;
+#else
+inline constexpr bool DisableBufferSizeCheck        = false;
+#endif
+#ifdef ENABLE_PRINTF_STRING
+inline constexpr bool EnablePrintfString            = true;
+#else
+inline constexpr bool EnablePrintfString            = false;
+#endif
+#ifdef ENABLE_PRINTF_CONST
+inline constexpr bool EnablePrintfConst             = true;
+#else
+inline constexpr bool EnablePrintfConst             = false;
+#endif
+#ifdef ENABLE_FMT_ID_FILE_LINE
+inline constexpr bool EnableFmtIdFileLine           = true;
 #else
-constexpr bool EnableFloatingCheck           = false;
+inline constexpr bool EnableFmtIdFileLine           = false;
 #endif
+#endif /** !PRINTF_CHECK_MODULE **/
 
 // ----------------------------------------------------------
 // Enable your own printf!
 // ----------------------------------------------------------
 
-#if 1
+#if defined(ENABLE_PRINTF_PROFILE)
+#define printf(...)                     do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); PRINTF_PROFILE(-1, FMT_CONST_CALL(stdout, FMT_CALL(printf, 0, __VA_ARGS__), __VA_ARGS__));         }while(0)
+#define fprintf(File, ...)              do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); PRINTF_PROFILE(-1, FMT_CONST_CALL(File, FMT_CALL(fprintf, 1, File, __VA_ARGS__), __VA_ARGS__));    }while(0)
+#define sprintf(BUFFER, ...)            do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); PRINTF_PROFILE(-1, FMT_CALL(sprintf, 1, BUFFER, __VA_ARGS__));                                     }while(0)
+#define snprintf(BUFFER, BUFSIZE, ...)  do{ PRINTF_CHECK(__VA_ARGS__); PRINTF_CHECK_BUFSIZE(BUFSIZE, __VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); PRINTF_PROFILE(-1, FMT_CALL(snprintf, 2, BUFFER, BUFSIZE, __VA_ARGS__)); }while(0)
+#elif defined(ENABLE_PRINTF_STRING) || defined(ENABLE_PRINTF_CONST)
+#define printf(...)                     do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); FMT_CONST_CALL(stdout, FMT_CALL(printf, 0, __VA_ARGS__), __VA_ARGS__);         }while(0)
+#define fprintf(File, ...)              do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); FMT_CONST_CALL(File, FMT_CALL(fprintf, 1, File, __VA_ARGS__), __VA_ARGS__);    }while(0)
+#define sprintf(BUFFER, ...)            do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); FMT_CALL(sprintf, 1, BUFFER, __VA_ARGS__);                                     }while(0)
+#define snprintf(BUFFER, BUFSIZE, ...)  do{ PRINTF_CHECK(__VA_ARGS__); PRINTF_CHECK_BUFSIZE(BUFSIZE, __VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); FMT_CALL(snprintf, 2, BUFFER, BUFSIZE, __VA_ARGS__); }while(0)
+#elif 1
 #define printf(...)                     do{ PRINTF_CHECK(__VA_ARGS__); printf(__VA_ARGS__);                    }while(0)
 #define fprintf(File, ...)              do{ PRINTF_CHECK(__VA_ARGS__); fprintf(File, __VA_ARGS__);             }while(0)
 #define sprintf(BUFFER, ...)            do{ PRINTF_CHECK(__VA_ARGS__); sprintf(BUFFER, __VA_ARGS__);           }while(0)
-#define snprintf(BUFFER, BUFSIZE, ...)  do{ PRINTF_CHECK(__VA_ARGS__); snprintf(BUFFER, BUFSIZE, __VA_ARGS__); }while(0)
+#define snprintf(BUFFER, BUFSIZE, ...)  do{ PRINTF_CHECK(__VA_ARGS__); PRINTF_CHECK_BUFSIZE(BUFSIZE, __VA_ARGS__); snprintf(BUFFER, BUFSIZE, __VA_ARGS__); }while(0)
 #endif
 
 /** *********************************************************************************
 //  this is another example if the special traces used have more arguments. 
 // The first argument of PRINTF_CHECK is the format text string, and then comes the arguments
 *********************************************************************************** **/
-#if 1
-#define TRACEPRINT(index, level, ...)  do{ PRINTF_CHECK(__VA_ARGS__); printf(__VA_ARGS__);   }while(0)
+//  the lower the level, the more important the trace, like syslog. The
+// traces above TRACE_LEVEL_COMPILED are removed but still checked, the
+// others compare their level with printfcheck::setTraceLevel() before
+// their arguments are evaluated
+#ifndef TRACE_LEVEL_COMPILED
+#define TRACE_LEVEL_COMPILED  0xFF
+#endif
+
+// with ENABLE_TRACE_SITES a site can also be switched on and off
+#if defined(ENABLE_TRACE_SITES)
+#define TRACE_IF_ON(level, ...)         TRACE_IF_SITE(level, __VA_ARGS__)
+#else
+#define TRACE_IF_ON(level, ...)         TRACE_IF_LEVEL(level, __VA_ARGS__)
+#endif
+
+#if defined(ENABLE_TRACE_DEFERRED)
+#define TRACEPRINT(index, level, ...)  do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); TRACE_IF_COMPILED(level, printfcheck::traceDeferred<FmtLiteralType>(level, __VA_ARGS__)); }while(0)
+#elif defined(ENABLE_PRINTF_PROFILE)
+#define TRACEPRINT(index, level, ...)  do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); TRACE_IF_ON(level, PRINTF_PROFILE(level, FMT_CONST_CALL(stdout, FMT_CALL((printf), 0, __VA_ARGS__), __VA_ARGS__))); }while(0)
+#elif 1
+#define TRACEPRINT(index, level, ...)  do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); TRACE_IF_ON(level, printf(__VA_ARGS__));   }while(0)
 #else
 #define TRACEPRINT(index, level, ...)
 #endif
 
+#ifndef PRINTF_CHECK_MODULE
+
 // ----------------------------------------------------------
 // error codes
 // ----------------------------------------------------------
@@ -78,20 +204,72 @@ enum class FmtError
     WarningFloatField    = -6,
 };
 
-constexpr std::string_view 
+// ----------------------------------------------------------
+// fmt field descriptors
+// ----------------------------------------------------------
+enum FmtFlag : uint8_t
+{
+    FmtFlagMinus = 1 << 0,
+    FmtFlagPlus  = 1 << 1,
+    FmtFlagHash  = 1 << 2,
+    FmtFlagZero  = 1 << 3,
+};
+
+enum class FmtLength : uint8_t
+{
+    None,
+    hh,
+    h,
+    l,
+    ll,
+    j,
+    z,
+    t,
+    L,
+};
+
+struct FmtFieldDesc
+{
+    uint32_t  offset     = 0;       // position of the '%' in the fmt
+    uint32_t  size       = 0;       // from '%' to the conversion, both included
+    char      conversion = 0;
+    uint8_t   flags      = 0;       // FmtFlag mask
+    FmtLength length     = FmtLength::None;
+    uint8_t   starCount  = 0;       // '*' width/precision arguments
+    bool      isValid    = true;
+    uint32_t  width      = 0;       // written width, 0 if none or '*'
+    int32_t   precision  = -1;      // written precision, -1 if none or '*'
+};
+
+// a fmt with N characters has at most N/2 fields: '%' + conversion
+template<uint32_t MaxFields>
+struct FmtFieldTable
+{
+    std::array<FmtFieldDesc, MaxFields> fields = {};
+    uint32_t                             size   = 0;
+};
+
+inline constexpr std::string_view
 FormatFieldList = { "scdiuopfFeEgGaAxXn" };
 
-constexpr std::string_view 
+inline constexpr std::string_view
 WidthSpecifierList = { "+-0123456789#.*hlzjtL" };
 
-constexpr std::string_view 
+inline constexpr std::string_view
 FormatFloatingPointList = { "fFeEgGaA" };
 
+#endif /** !PRINTF_CHECK_MODULE **/
+
 // ----------------------------------------------------------
 // defines and MACROs
 // ----------------------------------------------------------
 
+// C++20: the checks are immediate functions, they can't be emitted as code
+#if defined(__cpp_consteval) && (__cpp_consteval >= 201811L)
+#define CONSTEVAL consteval
+#else
 #define CONSTEVAL constexpr
+#endif
 
 #define CONCAT_IMPL(A, B) A##B
 #define CONCAT(A, B) CONCAT_IMPL(A, B)
@@ -99,64 +277,110 @@ FormatFloatingPointList = { "fFeEgGaA" };
 #define TO_STR(s) TO_STR_(s)
 #define TO_STR_(s) #s
 
-/** *************************************** **/
-/**  DECLTYPE_OF_N(...) MACRO               **/
-/** *************************************** **/
-#define GET_DECLTYPE_OF_N(...)             APPLY_OF_N(decltype, __VA_ARGS__)
+#define FILE_LINE_LIT()      TO_STR("(" __FILE__ ":" TO_STR(__LINE__) ")")
 
-/** *************************************** **/
-/**  APPLY_OF_N(...) MACRO                  **/
-/** *************************************** **/
-#define APPLY_OF_0(COMMAND, a)                  
-#define APPLY_OF_1(COMMAND, a)             COMMAND(a)         
-#define APPLY_OF_2(COMMAND, a, b)          COMMAND(a), APPLY_OF_1(COMMAND, b)
-#define APPLY_OF_3(COMMAND, a,...)         COMMAND(a), APPLY_OF_2(COMMAND, __VA_ARGS__)
-#define APPLY_OF_4(COMMAND, a,...)         COMMAND(a), APPLY_OF_3(COMMAND, __VA_ARGS__)
-#define APPLY_OF_5(COMMAND, a,...)         COMMAND(a), APPLY_OF_4(COMMAND, __VA_ARGS__)
-#define APPLY_OF_6(COMMAND, a,...)         COMMAND(a), APPLY_OF_5(COMMAND, __VA_ARGS__)
-#define APPLY_OF_7(COMMAND, a,...)         COMMAND(a), APPLY_OF_6(COMMAND, __VA_ARGS__)
-#define APPLY_OF_8(COMMAND, a,...)         COMMAND(a), APPLY_OF_7(COMMAND, __VA_ARGS__)
-#define APPLY_OF_9(COMMAND, a,...)         COMMAND(a), APPLY_OF_8(COMMAND, __VA_ARGS__)
-#define APPLY_OF_10(COMMAND, a,...)        COMMAND(a), APPLY_OF_9(COMMAND, __VA_ARGS__)
-#define APPLY_OF_11(COMMAND, a,...)        COMMAND(a), APPLY_OF_10(COMMAND, __VA_ARGS__)
-#define APPLY_OF_12(COMMAND, a,...)        COMMAND(a), APPLY_OF_11(COMMAND, __VA_ARGS__)
-#define APPLY_OF_13(COMMAND, a,...)        COMMAND(a), APPLY_OF_12(COMMAND, __VA_ARGS__)
-#define APPLY_OF_14(COMMAND, a,...)        COMMAND(a), APPLY_OF_13(COMMAND, __VA_ARGS__)
-#define APPLY_OF_15(COMMAND, a,...)        COMMAND(a), APPLY_OF_14(COMMAND, __VA_ARGS__)
-#define APPLY_OF_16(COMMAND, a,...)        COMMAND(a), APPLY_OF_15(COMMAND, __VA_ARGS__)
-
-#define APPLY_OF_N_PRIV(COMMAND, N, ...)   APPLY_OF_ ## N(COMMAND, __VA_ARGS__)
-#define APPLY_OF_N_PRIV_1(COMMAND, N, ...) APPLY_OF_N_PRIV(COMMAND, N, __VA_ARGS__)
-
-#define APPLY_OF_N(COMMAND, ...)           APPLY_OF_N_PRIV_1(COMMAND, GET_ARG_COUNT(__VA_ARGS__), __VA_ARGS__)
+// the fmt literal of a call as a type: FmtLiteralType::value()
+#define FMT_FIRST_ARG(fmt_literal, ...)     fmt_literal
+#define FMT_LITERAL_TYPE(...)                                                       \
+            struct FmtLiteralType                                                   \
+            {                                                                       \
+                static constexpr const char* value() { return FMT_FIRST_ARG(__VA_ARGS__, 0); } \
+                static constexpr const char* file()  { return __FILE__; }           \
+                static constexpr uint32_t    line()  { return __LINE__; }           \
+                static constexpr uint64_t    id()    { return makeFmtId(value(), file(), line()); } \
+            }
 
-/** *************************************** **/
-/**  GET_ARG_COUNT() MACRO                  **/
-/**  __VA_OPT__(,) needed for 0             **/
-/** *************************************** **/
-// GET_ARG_COUNT(...) evaluates to the literal number of the passed-in arguments.
-#define _GET_ARG_COUNT_PRIVATE(X,                      \
-                               Val63,Val62,Val61,Val60,\
-                               Val59,Val58,Val57,Val56,Val55,Val54,Val53,Val52,Val51,Val50,\
-                               Val49,Val48,Val47,Val46,Val45,Val44,Val43,Val42,Val41,Val40,\
-                               Val39,Val38,Val37,Val36,Val35,Val34,Val33,Val32,Val31,Val30,\
-                               Val29,Val28,Val27,Val26,Val25,Val24,Val23,Val22,Val21,Val20,\
-                               Val19,Val18,Val17,Val16,Val15,Val14,Val13,Val12,Val11,Val10,\
-                               Val9,Val8,Val7,Val6,Val5,Val4,Val3,Val2,Val1,N,...) N
-
-#define GET_ARG_COUNT(...) _GET_ARG_COUNT_PRIVATE(0, __VA_ARGS__ __VA_OPT__(,)63,62,61,60,\
-                                59,58,57,56,55,54,53,52,51,50,\
-                                49,48,47,46,45,44,43,42,41,40,\
-                                39,38,37,36,35,34,33,32,31,30,\
-                                29,28,27,26,25,24,23,22,21,20,\
-                                19,18,17,16,15,14,13,12,11,10,\
-                                9,8,7,6,5,4,3,2,1,0)
+// a constant level above TRACE_LEVEL_COMPILED is a constant false. A
+// level that isn't a constant is only checked at runtime
+#define TRACE_LEVEL_IS_COMPILED(level)                                              \
+            (__builtin_constant_p(level) ? (level) <= TRACE_LEVEL_COMPILED : true)
+
+// the statement runs when the level is compiled and on. A removed
+// statement is a dead branch like PRINTF_CHECK(): already checked, no
+// code even at -O0. The same code as a hand-written 'if'
+#define TRACE_IF_LEVEL(level, ...)                                                  \
+            do{ if (TRACE_LEVEL_IS_COMPILED(level) && printfcheck::isTraceLevelOn(level)) { __VA_ARGS__; } }while(0)
+
+// ... and its site is on: FmtLiteralType is the fmt of the site
+#define TRACE_IF_SITE(level, ...)                                                   \
+            do{ if (TRACE_LEVEL_IS_COMPILED(level)) {                               \
+                static printfcheck::TraceSite traceSite = printfcheck::makeTraceSite<FmtLiteralType>(); \
+                if (printfcheck::isTraceSiteOn(traceSite, level, __builtin_constant_p(level)) == true) { __VA_ARGS__; } } }while(0)
+
+// the statement of TRACE_IF_ON() isn't even instantiated when the level
+// is removed: the compiled condition is a template argument of a generic
+// lambda. For TRACEPRINT_FAST() and the deferred traces, whose templates
+// would otherwise be emitted at -O0
+#define TRACE_IF_COMPILED(level, ...)                                               \
+            [&](auto isCompiled) __attribute__((always_inline))                     \
+            {                                                                       \
+                if constexpr (decltype(isCompiled)::value == true) { TRACE_IF_ON(level, __VA_ARGS__); } \
+            }(FmtBoolConstant<TRACE_LEVEL_IS_COMPILED(level)>{})
+
+// the call of a wrapper, with 'leading' arguments before the fmt. With
+// ENABLE_PRINTF_STRING a call with strings goes through printfString():
+// FmtLiteralType is its fmt. The others stay a direct call, checked by
+// -Wformat: like TRACE_IF_COMPILED(), the choice is a template argument
+#if defined(ENABLE_PRINTF_STRING)
+#define FMT_CALL(function, leading, ...)                                            \
+            [&](auto hasString) __attribute__((always_inline)) -> int               \
+            {                                                                       \
+                if constexpr (decltype(hasString)::value == true) { return printfString<FmtLiteralType, leading>(&function, __VA_ARGS__); } \
+                else                                              { return function(__VA_ARGS__); } \
+            }(FmtBoolConstant<hasFmtStringArg(decltype(captureArgTypes(__VA_ARGS__)){})>{})
+#else
+#define FMT_CALL(function, leading, ...)    function(__VA_ARGS__)
+#endif
 
-#define FILE_LINE_LIT()      TO_STR("(" __FILE__ ":" TO_STR(__LINE__) ")")
+// ... and with ENABLE_PRINTF_CONST, an fwrite() on 'file' of its output
+// when the fast path supports the fmt and every argument is a constant.
+// The output is formatted at compile-time: like TRACE_IF_COMPILED(), the
+// size is a template argument of a lambda. 'call' stays a direct call,
+// in the other arm of a constant condition: always checked by -Wformat
+#if defined(ENABLE_PRINTF_CONST)
+#define FMT_CONST_SIZE(...)                                                         \
+            FmtSizeConstant<isFmtConstSupported<FmtLiteralType>(decltype(captureArgTypes(__VA_ARGS__)){}) && \
+                            __builtin_constant_p(formatFmtConst<FmtLiteralType>(nullptr, __VA_ARGS__)) ? \
+                            formatFmtConst<FmtLiteralType>(nullptr, __VA_ARGS__) : FmtConstNone>
+
+#define FMT_CONST_CALL(file, call, ...)                                             \
+            (FMT_CONST_SIZE(__VA_ARGS__)::value != FmtConstNone ?                   \
+            [&](auto constSize) __attribute__((always_inline)) -> int               \
+            {                                                                       \
+                constexpr uint32_t FmtConstSize = decltype(constSize)::value;       \
+                if constexpr (FmtConstSize != FmtConstNone)                         \
+                {                                                                   \
+                    static constexpr auto FmtConstText = makeFmtConstText<FmtLiteralType, FmtConstSize>(__VA_ARGS__); \
+                    return writeFmtConst(file, FmtConstText);                       \
+                }                                                                   \
+                else { return 0; }                                                  \
+            }(FMT_CONST_SIZE(__VA_ARGS__){}) : (call))
+#else
+#define FMT_CONST_CALL(file, call, ...)     call
+#endif
+
+// counts the calls and the bytes of the site: FmtLiteralType is its fmt
+#if defined(ENABLE_PRINTF_LATENCY)
+#define PRINTF_PROFILE(level, ...)                                                  \
+            do{ static printfcheck::PrintfSite printfSite = printfcheck::makePrintfSite<FmtLiteralType>(); \
+                uint64_t printfStart = printfcheck::getPrintfTicks();               \
+                int      printfBytes = __VA_ARGS__;                                 \
+                uint64_t printfTicks = printfcheck::getPrintfTicks() - printfStart; \
+                printfcheck::countPrintf(printfSite, level, printfBytes);           \
+                printfcheck::countPrintfLatency(printfSite, printfTicks); }while(0)
+#else
+#define PRINTF_PROFILE(level, ...)                                                  \
+            do{ static printfcheck::PrintfSite printfSite = printfcheck::makePrintfSite<FmtLiteralType>(); \
+                printfcheck::countPrintf(printfSite, level, __VA_ARGS__); }while(0)
+#endif
+
+// the ID of the call site, a constexpr uint64_t
+#define FMT_ID(fmt_literal)                 makeFmtId(fmt_literal, __FILE__, __LINE__)
 
 // ----------------------------------------------------------
 // static_warning()
 // ----------------------------------------------------------
+#ifndef PRINTF_CHECK_MODULE
 namespace detail
 {
     struct true_type  {};
@@ -164,6 +388,7 @@ namespace detail
     template <int test> struct converter    : public true_type  {};
     template <>         struct converter<0> : public false_type {};
 }
+#endif /** !PRINTF_CHECK_MODULE **/
 
 #define static_warning_impl(condition, WarningMessage, LINE_TXT)  \
 struct CONCAT(WarningStruct, LINE_TXT)                            \
@@ -190,181 +415,288 @@ struct CONCAT(WarningStruct, LINE_TXT)                            \
 // ----------------------------------------------------------
 // functions
 // ----------------------------------------------------------
+#ifndef PRINTF_CHECK_MODULE
 
 /** *****************************
-//  hasMoreThanOnceCharacter()
+//  fmt character classes
+//  a lookup per character instead of searching in the lists, the
+//  tables are usable at runtime too
 ****************************** **/
-CONSTEVAL
-uint32_t 
-hasMoreThanOnceCharacter(std::string_view fmtField, char c)
+enum FmtCharClass : uint8_t
 {
-    if(fmtField.empty() == true) return 0;
+    FmtClassSpecifier  = 1 << 0,    // WidthSpecifierList
+    FmtClassConversion = 1 << 1,    // FormatFieldList
+    FmtClassFloating   = 1 << 2,    // FormatFloatingPointList
+};
 
-    auto pos = fmtField.find(c);
-    if(pos == std::string::npos)
-        return 0;
+// characters with a limited number of occurrences in a field
+inline constexpr std::string_view
+FmtCountedCharList = { ".*+-hlzjtL" };
 
-    pos = fmtField.find(c, pos + 1);
-    if(pos == std::string::npos)
-        return 1;
+inline constexpr uint32_t
+FmtCountedCharMax[] = {  1, 1, 1, 1, 2, 2, 1, 1, 1, 1  };
 
-    pos = fmtField.find(c, pos + 1);
-    if(pos == std::string::npos)
-        return 2;
-    
-    //  for checking the width specifiers, at most we have the case of
-    // 'lld', where the 'l' is repeated twice. If there is more than twice,
-    // is an error
+inline constexpr uint32_t
+FmtCountedCharSize = sizeof(FmtCountedCharMax) / sizeof(FmtCountedCharMax[0]);
+
+struct FmtCharTable
+{
+    uint8_t classes[256]   = {};    // FmtCharClass mask
+    uint8_t countSlot[256] = {};    // 1 + index in FmtCountedCharList, 0 if not counted
+};
+
+constexpr
+FmtCharTable
+makeFmtCharTable()
+{
+    FmtCharTable table = {};
+
+    for(char c : WidthSpecifierList)      table.classes[(uint8_t)c] |= FmtClassSpecifier;
+    for(char c : FormatFieldList)         table.classes[(uint8_t)c] |= FmtClassConversion;
+    for(char c : FormatFloatingPointList) table.classes[(uint8_t)c] |= FmtClassFloating;
 
-    return 3;
+    for(uint32_t i = 0; i < FmtCountedCharList.size(); i++)
+        table.countSlot[(uint8_t)FmtCountedCharList[i]] = (uint8_t)(i + 1);
+
+    return table;
+}
+
+inline constexpr FmtCharTable FmtChars = makeFmtCharTable();
+
+constexpr
+bool
+isFmtCharClass(char c, FmtCharClass charClass)
+{
+    return (FmtChars.classes[(uint8_t)c] & charClass) != 0;
 }
 
 /** *****************************
 //  checkFmtFieldValidity()
 //  '-', '+', '#', 0
 //  'h', 'l', 'hh', 'll', 'z', 'j', 't', 'L'
+//  one pass builds the histogram of the counted characters
 ****************************** **/
-CONSTEVAL
+constexpr
 bool 
 checkFmtFieldValidity(std::string_view fmtField)
 {
-    if(fmtField.empty() == true) return true;
+    uint32_t counter[1 + FmtCountedCharSize] = {};
+
+    for(char c : fmtField)
+        counter[FmtChars.countSlot[(uint8_t)c]]++;
+
+    //  for checking the width specifiers, at most we have the case of
+    // 'lld', where the 'l' is repeated twice. If there is more than twice,
+    // is an error
+    for(uint32_t i = 0; i < FmtCountedCharSize; i++)
+    {
+        if(counter[1 + i] > FmtCountedCharMax[i]) return false;
+    }
 
-    uint32_t counter = 0;
+    // 'h' and 'l' at the same time
+    bool isHandL = counter[FmtChars.countSlot[(uint8_t)'h']] > 0 &&
+                   counter[FmtChars.countSlot[(uint8_t)'l']] > 0;
+    if(isHandL == true) return false;
 
-    // More than one '.'
-    counter = hasMoreThanOnceCharacter(fmtField, '.');
-    if(counter > 1) return false;
+    return true;
+}
 
-    // More than one '*'
-    counter = hasMoreThanOnceCharacter(fmtField, '*');
-    if(counter > 1) return false;
+/** *****************************
+//  makeFmtFieldDesc()
+//  fmtField goes from the '%' to the conversion character
+****************************** **/
+constexpr
+FmtFieldDesc
+makeFmtFieldDesc(std::string_view fmtField, uint32_t Offset)
+{
+    FmtFieldDesc desc = {};
 
-    // More than one '+'
-    counter = hasMoreThanOnceCharacter(fmtField, '+');
-    if(counter > 1) return false;
+    desc.offset     = Offset;
+    desc.size       = (uint32_t)fmtField.size();
+    desc.conversion = fmtField.back();
+    desc.isValid    = checkFmtFieldValidity(fmtField);
 
-    // More than one '-'
-    counter = hasMoreThanOnceCharacter(fmtField, '-');
-    if(counter > 1) return false;
+    // skip '%' and the conversion character
+    std::string_view spec = fmtField.substr(1, fmtField.size() - 2);
 
-    // More than twice 'h'
-    counter = hasMoreThanOnceCharacter(fmtField, 'h');
-    if(counter > 2) return false;
+    uint32_t Index = 0;
 
-    // More than twice 'l'
-    counter = hasMoreThanOnceCharacter(fmtField, 'l');
-    if(counter > 2) return false;
+    // flags are only the leading characters, '0' after them is the width
+    for(; Index < spec.size(); Index++)
+    {
+        char c = spec[Index];
 
-    // 'h' and 'l' at the same time
-    bool isHandL = (fmtField.find('l') != std::string::npos) && (fmtField.find('h') != std::string::npos);
-    if(isHandL == true) return false;
+        if     (c == '-') desc.flags |= FmtFlagMinus;
+        else if(c == '+') desc.flags |= FmtFlagPlus;
+        else if(c == '#') desc.flags |= FmtFlagHash;
+        else if(c == '0') desc.flags |= FmtFlagZero;
+        else              break;
+    }
 
-    // More than one 'z'
-    counter = hasMoreThanOnceCharacter(fmtField, 'z');
-    if(counter > 1) return false;
+    uint32_t hCounter    = 0;
+    uint32_t lCounter    = 0;
+    bool     isPrecision = false;
 
-    // More than one 'j'
-    counter = hasMoreThanOnceCharacter(fmtField, 'j');
-    if(counter > 1) return false;
+    // widths above FmtMaxWidth are saturated, they don't overflow
+    constexpr uint32_t FmtMaxWidth = 99999999;
 
-    // More than one 't'
-    counter = hasMoreThanOnceCharacter(fmtField, 't');
-    if(counter > 1) return false;
+    for(; Index < spec.size(); Index++)
+    {
+        char c = spec[Index];
+
+        if     (c == '*') { desc.starCount++; if(isPrecision == true) desc.precision = -1; }
+        else if(c == '.') { isPrecision = true; desc.precision = 0; }
+        else if(c >= '0' && c <= '9' && isPrecision == true)
+        {
+            uint32_t value = (uint32_t)desc.precision * 10 + (uint32_t)(c - '0');
+            desc.precision = (int32_t)(value < FmtMaxWidth ? value : FmtMaxWidth);
+        }
+        else if(c >= '0' && c <= '9')
+        {
+            uint32_t value = desc.width * 10 + (uint32_t)(c - '0');
+            desc.width = value < FmtMaxWidth ? value : FmtMaxWidth;
+        }
+        else if(c == 'h') hCounter++;
+        else if(c == 'l') lCounter++;
+        else if(c == 'j') desc.length = FmtLength::j;
+        else if(c == 'z') desc.length = FmtLength::z;
+        else if(c == 't') desc.length = FmtLength::t;
+        else if(c == 'L') desc.length = FmtLength::L;
+    }
 
-    // More than one 'L'
-    counter = hasMoreThanOnceCharacter(fmtField, 'L');
-    if(counter > 1) return false;
+    if     (hCounter == 1) desc.length = FmtLength::h;
+    else if(hCounter >= 2) desc.length = FmtLength::hh;
+    else if(lCounter == 1) desc.length = FmtLength::l;
+    else if(lCounter >= 2) desc.length = FmtLength::ll;
 
-    return true;
+    return desc;
 }
 
 /** *****************************
-//  getFieldIndicesWithoutCheck()
+//  parseFmtFields()
+//  single pass over the fmt, every field is described once
 ****************************** **/
-CONSTEVAL 
-auto 
-getFieldIndicesWithoutCheck(std::string_view fmtSv, uint32_t StartIndex)
--> std::tuple<bool             /** atEnd?     **/,
-              uint32_t         /** NextIndex  **/,
-              std::string_view /** FmtField   **/ >
+template<uint32_t MaxFields>
+constexpr
+auto
+parseFmtFields(std::string_view fmtSv)
+-> FmtFieldTable<MaxFields>
 {
-    uint32_t Index = StartIndex;
-
-    if(StartIndex >= fmtSv.size()) return { true, Index, {} };
+    FmtFieldTable<MaxFields> table = {};
 
-    Index = fmtSv.find('%', Index);
-    if(Index == (uint32_t)std::string::npos){
-        return { true, Index, {} };
-    }
-    StartIndex = Index;
+    std::size_t Index = fmtSv.find('%');
 
-    Index++;    // skip '%'
-    // -------------------------------------
-    if(Index < fmtSv.size() && fmtSv[Index] == '%')
+    while(Index != std::string_view::npos)
     {
-        // avoid '%%d'
-        Index = fmtSv.find_first_not_of('%', Index);
-        if(Index == (uint32_t)std::string::npos) return { true, Index, {} };
+        std::size_t StartIndex = Index;
+
+        Index++;    // skip '%'
+        // -------------------------------------
+        if(Index < fmtSv.size() && fmtSv[Index] == '%')
+        {
+            // '%%' is the '%' character, not a field
+            Index = fmtSv.find('%', Index + 1);
+            continue;
+        }
+        // -------------------------------------
 
-        bool isEven = (Index - StartIndex) % 2 == 0;
+        while(Index < fmtSv.size() && isFmtCharClass(fmtSv[Index], FmtClassSpecifier) == true)
+            Index++;
 
-        // '%%d'
-        if(isEven == true)
+        if(Index >= fmtSv.size()) break;
+
+        if(isFmtCharClass(fmtSv[Index], FmtClassConversion) == false)
         {
-            return { false, Index, {} };
+            // not a conversion, continue from this character
+            Index = fmtSv.find('%', Index);
+            continue;
         }
 
-        // Adjust StartIndex, to remove extra '%'
-        StartIndex = Index - 1;
-    }
-    // -------------------------------------
+        auto fieldFmtSv = fmtSv.substr(StartIndex, Index - StartIndex + 1);
 
-    // Index = fmtSv.find_first_not_of("+-0123456789#.*hlzjtL", Index);
-    Index = fmtSv.find_first_not_of(WidthSpecifierList, Index);
-    if(Index == (uint32_t)std::string::npos){
-        return { true, Index, {} };
+        table.fields[table.size] = makeFmtFieldDesc(fieldFmtSv, (uint32_t)StartIndex);
+        table.size++;
+
+        Index = fmtSv.find('%', Index + 1);
     }
 
-    if (FormatFieldList.find(fmtSv[Index]) == std::string_view::npos)
+    return table;
+}
+
+/** *****************************
+//  parseFmtLiteral()
+//  entry point of the checks, always evaluated at compile-time
+****************************** **/
+template<uint32_t MaxFields>
+CONSTEVAL
+auto
+parseFmtLiteral(std::string_view fmtSv)
+-> FmtFieldTable<MaxFields>
+{
+    return parseFmtFields<MaxFields>(fmtSv);
+}
+
+/** *****************************
+//  countFmtArgs()
+//  the fields after a non-conformant one aren't taken into account
+****************************** **/
+template<uint32_t MaxFields>
+CONSTEVAL
+uint32_t
+countFmtArgs(const FmtFieldTable<MaxFields>& table)
+{
+    uint32_t Counter = 0;
+
+    for(uint32_t i = 0; i < table.size; i++)
     {
-        // not found
-        return { false, Index, {} };
+        if(table.fields[i].isValid == false) break;
+
+        // "%.*s", "%*s", and also "%*d"
+        Counter += 1 + table.fields[i].starCount;
     }
 
-    auto fieldFmtSv = std::string_view(fmtSv.data() + StartIndex, Index - StartIndex + 1);
+    return Counter;
+}
 
-    #if 0
-    bool isValid = checkFmtFieldValidity(fieldFmtSv);
-    if(isValid == false) 
-        return { false, Index, {} };  
-    #endif
+/** *****************************
+//  checkFmtTableValidity()
+****************************** **/
+template<uint32_t MaxFields>
+CONSTEVAL
+FmtError
+checkFmtTableValidity(const FmtFieldTable<MaxFields>& table)
+{
+    for(uint32_t i = 0; i < table.size; i++)
+    {
+        if(table.fields[i].isValid == false)
+            return FmtError::WarningFieldValidity;
+    }
 
-    return { false, Index, fieldFmtSv };
+    return FmtError::NoError;
 }
 
 /** *****************************
-//  getFieldIndices()
+//  FmtFieldsOf<>
+//  C++20: the literal is a template argument, so the table is parsed
+//  once per distinct fmt and shared by every call site of the TU
 ****************************** **/
-CONSTEVAL 
-auto 
-getFieldIndices(std::string_view fmtSv, uint32_t StartIndex)
--> std::tuple<bool             /** atEnd?     **/,
-              uint32_t         /** NextIndex  **/,
-              std::string_view /** FmtField   **/ >
+#if defined(__cpp_nontype_template_args) && (__cpp_nontype_template_args >= 201911L)
+
+template<std::size_t N>
+struct FmtLiteral
 {
-    auto fieldPack            = getFieldIndicesWithoutCheck(fmtSv, StartIndex);
+    char value[N] = {};
+
+    constexpr FmtLiteral(const char (&literal)[N])
+    {
+        for(std::size_t i = 0; i < N; i++) value[i] = literal[i];
+    }
+};
 
-    bool atEnd                = std::get<0>(fieldPack);
-    uint32_t NextStartIndex   = std::get<1>(fieldPack);
-    std::string_view FmtField = std::get<2>(fieldPack);
+template<FmtLiteral Fmt>
+inline constexpr auto FmtFieldsOf = parseFmtLiteral<(sizeof(Fmt.value) - 1) / 2>(Fmt.value);
 
-    bool isValid = checkFmtFieldValidity(FmtField);
-    if(isValid == false) 
-        return { atEnd, NextStartIndex, {} };
-    else
-        return { atEnd, NextStartIndex, FmtField };
-}
+#endif
 
 //  helper: isANumber()
 template<typename T>
@@ -400,28 +732,20 @@ isPointerToNumber()
 }
 
 //  helper: isFieldANumber()
-CONSTEVAL bool 
-isFieldANumber(std::string_view sv)
+constexpr bool 
+isFieldANumber(char c)
 {
-    if(sv.empty() == true) return false;
-
-    char c = sv.back();
-
-    if((c != 's') && (FormatFieldList.find(c) != std::string_view::npos) )
+    if((c != 's') && isFmtCharClass(c, FmtClassConversion) == true)
         return true;
 
     return false;
 }
 
 //  helper: isFieldAFloatingNumber()
-CONSTEVAL bool 
-isFieldAFloatingNumber(std::string_view sv)
+constexpr bool 
+isFieldAFloatingNumber(char c)
 {
-    if(sv.empty() == true) return false;
-
-    char c = sv.back();
-
-    if(FormatFloatingPointList.find(c) != std::string_view::npos)
+    if(isFmtCharClass(c, FmtClassFloating) == true)
         return true;
 
     return false;
@@ -438,197 +762,3965 @@ isCharArray()
            std::is_same_v<SimplifiedType, char*>;
 }
 
+//  helper: isFmtString(), std::string and std::string_view for "%s"
+//  with ENABLE_PRINTF_STRING
+template<typename T>
+struct FmtIsString                                             : std::false_type {};
+
+#ifdef ENABLE_PRINTF_STRING
+template<typename Traits, typename Alloc>
+struct FmtIsString<std::basic_string<char, Traits, Alloc>>     : std::true_type  {};
+
+template<typename Traits>
+struct FmtIsString<std::basic_string_view<char, Traits>>       : std::true_type  {};
+#endif
+
+template<typename T>
+CONSTEVAL bool
+isFmtString()
+{
+    return FmtIsString<std::decay_t<T>>::value;
+}
+
 /** ***************************************************************** **/
-/**       COMPILE-TIME printf template functions                      **/
+/**       COMPILE-TIME printf argument checks                         **/
 /** ***************************************************************** **/
 
-template<uint32_t Start, uint32_t End, class Func>
-constexpr 
-FmtError 
-constexpr_for_valididy (Func func)
+struct FmtArgDesc
 {
-    if constexpr (Start < End)
-    {
-        constexpr auto fieldPack            = func (Start);
+    bool isNumber          = false;
+    bool isFloatingPoint   = false;
+    bool isCharArray       = false;
+    bool isPointerToNumber = false;
+    bool isString          = false;     // ENABLE_PRINTF_STRING: printed as "%.*s"
+};
+
+template<typename T>
+CONSTEVAL
+FmtArgDesc
+makeFmtArgDesc()
+{
+    FmtArgDesc desc = {};
 
-        constexpr bool     atEnd            = std::get<0>(fieldPack);
-        constexpr uint32_t NextStartIndex   = std::get<1>(fieldPack);
-        constexpr std::string_view FmtField = std::get<2>(fieldPack);
+    desc.isNumber          = isANumber<T>();
+    desc.isFloatingPoint   = std::is_floating_point_v< std::decay_t<T> >;
+    desc.isCharArray       = isCharArray<T>();
+    desc.isPointerToNumber = isPointerToNumber<T>();
+    desc.isString          = isFmtString<T>();
 
-        if (atEnd == true || FmtField.empty() == true) {
-            return FmtError::NoError;
-        }
+    return desc;
+}
+
+// minimal type list of the arguments, <tuple> isn't needed
+template<typename... Args>
+struct FmtTypeList
+{
+    static constexpr std::size_t size = sizeof...(Args);
+};
 
-        bool isValid = checkFmtFieldValidity(FmtField);
-        if(isValid == false) 
+// one descriptor per argument, built with a single pack expansion
+template<typename ArgsTypeList>
+struct FmtArgTable;
+
+template<typename... Args>
+struct FmtArgTable<FmtTypeList<Args...>>
+{
+    static constexpr std::array<FmtArgDesc, sizeof...(Args)> value = { makeFmtArgDesc<Args>()... };
+};
+
+/** *****************************
+//  captureArgTypes()
+//  only used inside decltype(), it is never called. The arguments are
+//  taken by value so that bit-fields can be passed too
+****************************** **/
+template<typename... Args>
+auto
+captureArgTypes(Args... args)
+-> FmtTypeList<Args...>;
+
+/** *****************************
+//  checkFmtFieldArgs()
+//  the arguments of a valid field, from args[SelectedIndex]. Also used
+//  at runtime by printfcheck::validate()
+****************************** **/
+constexpr
+FmtError
+checkFmtFieldArgs(const FmtFieldDesc& Field, const FmtArgDesc* args, std::size_t ArgsSize, uint32_t SelectedIndex)
+{
+    const FmtArgDesc& Arg = args[SelectedIndex];
+
+    if(Field.starCount > 0)
+    {
+        if (SelectedIndex + 1 < ArgsSize)
         {
-            return FmtError::WarningFieldValidity;
+            const FmtArgDesc& SecondArg = args[SelectedIndex + 1];
+
+            if (Field.conversion == 's')
+            {
+                if( !(Arg.isNumber == true && (SecondArg.isCharArray == true || SecondArg.isString == true)) )
+                {
+                    return FmtError::ErrorCharArray;
+                }
+            }
+            else
+            // "%*d"
+            {
+                if( !(Arg.isNumber == true && SecondArg.isNumber == true) )
+                {
+                    return FmtError::ErrorWidthVariable;
+                }
+            }
+        }
+    }
+    else
+    {
+        /** *************** **/
+        /** Type Comparison **/
+        /** *************** **/
+        if (Field.conversion == 's' && Field.size == 2)         // "%s"
+        {
+            if (Arg.isCharArray == false &&
+                Arg.isString    == false)       return FmtError::ErrorString;
         }
+        else if (Field.conversion == 'n' && Field.size == 2)    // "%n"
+        {
+            if (Arg.isPointerToNumber == false) return FmtError::ErrorNumber;
+        }
+        else if (isFieldANumber(Field.conversion) == true)
+        {
+            if (Arg.isNumber == false)          return FmtError::ErrorNumber;
 
-        auto ret = constexpr_for_valididy<NextStartIndex, End>( func );
-        if(ret != FmtError::NoError) return ret;
+            if (EnableFloatingCheck == true &&
+                isFieldAFloatingNumber(Field.conversion) == true &&
+                Arg.isFloatingPoint == false)
+            {
+                                                return FmtError::WarningFloatField;
+            }
+        }
     }
 
     return FmtError::NoError;
 }
 
-template<uint32_t Start, uint32_t End, class F>
-constexpr 
-uint32_t 
-constexpr_for_arg_counter (F func)
+/** *****************************
+//  checkFmtArgs()
+//  walks the fields and the arguments side by side, no template recursion
+****************************** **/
+template<uint32_t MaxFields, std::size_t ArgsSize>
+CONSTEVAL
+FmtError
+checkFmtArgs(const FmtFieldTable<MaxFields>& table, const std::array<FmtArgDesc, ArgsSize>& args)
 {
-    uint32_t Counter = 0;
-    if constexpr (Start < End)
+    uint32_t SelectedIndex = 0;
+
+    for(uint32_t i = 0; i < table.size; i++)
     {
-        constexpr auto fieldPack = func (Start);
+        const FmtFieldDesc& Field = table.fields[i];
+
+        if (Field.isValid == false) {
+            return FmtError::NoError;  // not an error, the validity check warns about it
+        }
 
-        constexpr bool atEnd                = std::get<0>(fieldPack);
-        constexpr uint32_t NextStartIndex   = std::get<1>(fieldPack);
-        constexpr std::string_view FmtField = std::get<2>(fieldPack);
-        
-        if (atEnd == true || FmtField.empty() == true) {
-            return 0;
+        if (SelectedIndex >= ArgsSize) {
+            return FmtError::NoError;  // too few arguments, already checked
         }
 
-        using namespace std::literals;
+        FmtError errorCode = checkFmtFieldArgs(Field, args.data(), ArgsSize, SelectedIndex);
+        if (errorCode != FmtError::NoError) return errorCode;
 
         // "%.*s", "%*s", and also "%*d"
-        bool IsWidthPrecisionAdded = FmtField.find('*') != std::string_view::npos;
-        // constexpr auto WidthFormat = FmtField.substr(0, FmtField.size() - 1);
-        // bool IsWidthPrecisionAdded = (WidthFormat == "%.*"sv) || (WidthFormat == "%*"sv);
+        SelectedIndex += 1 + Field.starCount;
+    }
 
-        Counter += (IsWidthPrecisionAdded == true)? 2 : 1;
+    return FmtError::NoError;
+}
 
-        Counter += constexpr_for_arg_counter<NextStartIndex, End>( func );
-    }
+/** *****************************
+//  checkFmt()
+//  every check of a call site in one evaluation, the fmt is parsed once.
+//  The results are packed in a scalar: an unused constexpr scalar takes
+//  no room in the stack frame, not even at -O0
+****************************** **/
+enum class FmtCheckResult : uint64_t {};
 
-    return Counter;
+constexpr
+FmtCheckResult
+makeFmtCheckResult(uint32_t argCounter, FmtError errorCode, FmtError warningCode)
+{
+    return (FmtCheckResult)( (uint64_t)argCounter                         |
+                             (uint64_t)(uint8_t)(-(int)errorCode)   << 32 |
+                             (uint64_t)(uint8_t)(-(int)warningCode) << 40 );
 }
 
-template<uint32_t Start, uint32_t End, 
-         uint32_t SelectedIndex,
-         typename TupleWithTypes, class F>
-constexpr 
-FmtError 
-constexpr_for_check_Field (F func)
+constexpr uint32_t getFmtArgCounter (FmtCheckResult result) { return (uint32_t)result; }
+constexpr FmtError getFmtErrorCode  (FmtCheckResult result) { return (FmtError)(-(int)(uint8_t)((uint64_t)result >> 32)); }
+constexpr FmtError getFmtWarningCode(FmtCheckResult result) { return (FmtError)(-(int)(uint8_t)((uint64_t)result >> 40)); }
+
+template<uint32_t MaxFields, std::size_t ArgsSize>
+CONSTEVAL
+FmtCheckResult
+checkFmt(const FmtFieldTable<MaxFields>& table, const std::array<FmtArgDesc, ArgsSize>& args)
 {
-    if constexpr (Start < End)
+    FmtError warningCode = FmtError::NoError;
+
+    if constexpr(DisableFmtFieldValidity == false)
     {
-        constexpr auto fieldPack = func (Start);
+        warningCode = checkFmtTableValidity(table);
+    }
 
-        constexpr bool atEnd                = std::get<0>(fieldPack);
-        constexpr uint32_t NextStartIndex   = std::get<1>(fieldPack);
-        constexpr std::string_view FmtField = std::get<2>(fieldPack);
+    return makeFmtCheckResult(countFmtArgs(table), checkFmtArgs(table, args), warningCode);
+}
 
-        if (atEnd == true || FmtField.empty() == true) {
-            return FmtError::NoError;  // not an error, has just finished
-        }
-        using namespace std::literals;
+/** *****************************
+//  getFmtMaxSize()
+//  the longest output of a fmt, without the '\0': the text, and each
+//  field at its widest value. FmtSizeUnbounded when a field has no
+//  bound: "%s" without precision, '*', "%L" floats, a non-conformant one
+//  or a '%' that isn't a field
+****************************** **/
+inline constexpr uint32_t FmtSizeUnbounded = 0xFFFFFFFF;
 
-        constexpr uint32_t TupleSize = std::tuple_size_v<TupleWithTypes>;
-        constexpr bool     IsWidthPrecisionAdded = FmtField.find('*') != std::string_view::npos;
-        constexpr uint32_t NextSelectedIndex     = (IsWidthPrecisionAdded == true)? SelectedIndex + 2 : SelectedIndex + 1;
+// the digits of the largest value, with the '-' of the signed ones
+constexpr
+uint32_t
+getFmtIntegerMaxSize(char conversion, uint32_t bits)
+{
+    if (conversion == 'x' || conversion == 'X') return bits / 4;
+    if (conversion == 'o')                      return (bits + 2) / 3;
 
-        if constexpr ( SelectedIndex < TupleSize )
-        {
-            using TupleType = std::tuple_element_t<SelectedIndex, TupleWithTypes>;
+    uint32_t digits = bits == 8 ? 3 : bits == 16 ? 5 : bits == 32 ? 10 : 20;
 
-            if(IsWidthPrecisionAdded == true)
-            {
-                if constexpr (SelectedIndex + 1 < TupleSize)
-                {
-                    using TupleSecondType = std::tuple_element_t<SelectedIndex + 1, TupleWithTypes>;
+    // '-' + 19 digits of INT64_MIN
+    if (conversion == 'd' || conversion == 'i') return bits == 64 ? 20 : digits + 1;
 
-                    if (FmtField.back() == 's')
-                    {       
-                        if( !(isANumber<TupleType>() == true &&
-                              isCharArray<TupleSecondType>() == true) )
-                        {
-                            return FmtError::ErrorCharArray;
-                        }
-                    }
-                    else
-                    // "%*d"
-                    {
-                        if( !(isANumber<TupleType>() == true &&
-                              isANumber<TupleSecondType>() == true) )
-                        {
-                            return FmtError::ErrorWidthVariable;
-                        }
-                    }
-                }
+    return digits;
+}
+
+constexpr
+uint32_t
+getFmtFieldMaxSize(const FmtFieldDesc& field)
+{
+    if (field.isValid == false || field.starCount > 0) return FmtSizeUnbounded;
+
+    uint32_t precision = field.precision >= 0 ? (uint32_t)field.precision : 6;
+    uint32_t size      = 0;
+
+    switch(field.conversion)
+    {
+    case 'n':
+        return 0;
+
+    case 'c':
+        size = field.length == FmtLength::l ? 16 : 1;    // MB_LEN_MAX of a wide character
+        break;
+
+    case 's':
+        if (field.precision < 0) return FmtSizeUnbounded;
+        size = (uint32_t)field.precision;
+        break;
+
+    case 'p':
+        size = 2 + sizeof(void*) * 2;                    // "0x" + the digits, "(nil)" is shorter
+        break;
+
+    // double: '-', 309 digits of DBL_MAX, '.', the precision
+    case 'f': case 'F':
+        if (field.length == FmtLength::L) return FmtSizeUnbounded;
+        size = 1 + 309 + 1 + precision;
+        break;
+
+    // '-', "d.", the precision, "e+308"
+    case 'e': case 'E':
+        if (field.length == FmtLength::L) return FmtSizeUnbounded;
+        size = 1 + 2 + precision + 5;
+        break;
+
+    // the longest of "-d.ddde+308" and "-0.000ddd"
+    case 'g': case 'G':
+        if (field.length == FmtLength::L) return FmtSizeUnbounded;
+        size = 1 + 1 + (precision > 0 ? precision : 1) + 5;
+        break;
+
+    // '-', "0x1.", 13 hex digits by default, "p+1023"
+    case 'a': case 'A':
+        if (field.length == FmtLength::L) return FmtSizeUnbounded;
+        size = 1 + 4 + (field.precision >= 0 ? precision : 13) + 6;
+        break;
+
+    default:
+    {
+        uint32_t bits = field.length == FmtLength::hh ? 8                      :
+                        field.length == FmtLength::h  ? 16                     :
+                        field.length == FmtLength::l  ? sizeof(long) * 8       :
+                        field.length == FmtLength::j  ? sizeof(intmax_t) * 8   :
+                        field.length == FmtLength::z  ? sizeof(size_t) * 8     :
+                        field.length == FmtLength::t  ? sizeof(ptrdiff_t) * 8  :
+                        field.length == FmtLength::ll ||
+                        field.length == FmtLength::L  ? 64                     : sizeof(int) * 8;
+
+        size = getFmtIntegerMaxSize(field.conversion, bits);
+
+        // the precision pads the digits, the sign is apart
+        bool isSigned = field.conversion == 'd' || field.conversion == 'i';
+        if (field.precision >= 0 && precision + (isSigned == true ? 1 : 0) > size)
+            size = precision + (isSigned == true ? 1 : 0);
+
+        // '+' takes the room of '-'. '#': "0x" or the leading '0'
+        if ((field.flags & FmtFlagHash) != 0) size += field.conversion == 'o' ? 1 : 2;
+        break;
+    }
+    }
+
+    return field.width > size ? field.width : size;
+}
+
+template<uint32_t MaxFields>
+constexpr
+uint32_t
+getFmtMaxSize(const FmtFieldTable<MaxFields>& table, std::string_view fmtSv)
+{
+    uint64_t size       = 0;
+    uint32_t FieldIndex = 0;
+
+    for(uint32_t Index = 0; Index < fmtSv.size(); )
+    {
+        if (FieldIndex < table.size && table.fields[FieldIndex].offset == Index)
+        {
+            uint32_t FieldSize = getFmtFieldMaxSize(table.fields[FieldIndex]);
+            if (FieldSize == FmtSizeUnbounded) return FmtSizeUnbounded;
+
+            size  += FieldSize;
+            Index += table.fields[FieldIndex].size;
+            FieldIndex++;
+            continue;
+        }
+
+        // '%%' is a single '%'. A '%' that isn't a field is still formatted
+        // by printf(): its output is unknown
+        if (fmtSv[Index] == '%')
+        {
+            if (Index + 1 >= fmtSv.size() || fmtSv[Index + 1] != '%') return FmtSizeUnbounded;
+            Index++;
+        }
+
+        Index++;
+        size++;
+    }
+
+    return size < FmtSizeUnbounded ? (uint32_t)size : FmtSizeUnbounded;
+}
+
+// the bound of a fmt literal type: FmtMaxSizeOf<FmtLiteralType>
+template<typename Fmt>
+inline constexpr uint32_t FmtMaxSizeOf = getFmtMaxSize(parseFmtFields<std::string_view(Fmt::value()).size() / 2>(Fmt::value()),
+                                                       Fmt::value());
+
+/** *****************************
+//  hashFmtFnv1a()
+//  64-bit FNV-1a: the same value with every compiler and build
+****************************** **/
+inline constexpr uint64_t FmtHashOffset = 0xcbf29ce484222325ULL;
+inline constexpr uint64_t FmtHashPrime  = 0x00000100000001b3ULL;
+
+constexpr
+uint64_t
+hashFmtFnv1a(std::string_view data, uint64_t hash = FmtHashOffset)
+{
+    for(char c : data)
+    {
+        hash ^= (uint8_t)c;
+        hash *= FmtHashPrime;
+    }
+
+    return hash;
+}
+
+/** *****************************
+//  makeFmtId()
+//  the ID of a call site: the hash of its fmt and, with
+//  ENABLE_FMT_ID_FILE_LINE, of its file and line. __FILE__ is the path
+//  given to the compiler: -ffile-prefix-map keeps it the same between
+//  builds
+****************************** **/
+constexpr
+uint64_t
+makeFmtId(std::string_view fmt, std::string_view file, uint32_t line, bool withFileLine = EnableFmtIdFileLine)
+{
+    uint64_t hash = hashFmtFnv1a(fmt);
+
+    if (withFileLine == true)
+    {
+        // the '\0' separates the fmt from the file, the line is little endian
+        const char lineBytes[4] = { (char)(line & 0xFF), (char)((line >> 8) & 0xFF), (char)((line >> 16) & 0xFF), (char)(line >> 24) };
+
+        hash = hashFmtFnv1a(std::string_view("", 1), hash);
+        hash = hashFmtFnv1a(file, hash);
+        hash = hashFmtFnv1a(std::string_view(lineBytes, sizeof(lineBytes)), hash);
+    }
+
+    return hash;
+}
+
+/** *****************************
+//  FmtIdEntry
+//  ENABLE_FMT_ID_TABLE: every PRINTF_CHECK() leaves its ID, fmt, file
+//  and line in the binary, "printfcheck-decode --check" finds the IDs
+//  of different sites that collide. GCC ignores the section of template
+//  data and keeps the entries in .rodata, they are found by their magic
+****************************** **/
+struct FmtIdHeader
+{
+    char     magic[8] = { 'P', 'F', 'C', 'I', 'D', '0', '0', '1' };
+    uint64_t id       = 0;
+    uint32_t line     = 0;
+    uint32_t fmtSize  = 0;                      // with the '\0'
+    uint32_t fileSize = 0;
+    uint32_t flags    = 0;                      // FmtIdFileLine
+};
+
+inline constexpr uint32_t FmtIdFileLine = 1;    // the file and the line are in the ID
+
+constexpr
+uint32_t
+getFmtIdEntrySize(uint32_t fmtSize, uint32_t fileSize)
+{
+    return ((uint32_t)sizeof(FmtIdHeader) + fmtSize + fileSize + 7) & ~7u;
+}
+
+template<uint32_t FmtSize, uint32_t FileSize>
+struct alignas(8) FmtIdEntry
+{
+    FmtIdHeader header         = {};
+    char        fmt [FmtSize]  = {};
+    char        file[FileSize] = {};
+};
+
+template<typename Fmt>
+CONSTEVAL
+auto
+makeFmtIdEntry()
+{
+    constexpr std::string_view FmtSv  = Fmt::value();
+    constexpr std::string_view FileSv = Fmt::file();
+
+    using Entry = FmtIdEntry<FmtSv.size() + 1, FileSv.size() + 1>;
+    static_assert(sizeof(Entry) == getFmtIdEntrySize(FmtSv.size() + 1, FileSv.size() + 1), "FmtIdEntry layout");
+
+    Entry entry = {};
+
+    entry.header.id       = Fmt::id();
+    entry.header.line     = Fmt::line();
+    entry.header.fmtSize  = (uint32_t)FmtSv.size() + 1;
+    entry.header.fileSize = (uint32_t)FileSv.size() + 1;
+    entry.header.flags    = EnableFmtIdFileLine == true ? FmtIdFileLine : 0;
+
+    for(uint32_t i = 0; i < FmtSv.size(); i++)  entry.fmt[i]  = FmtSv[i];
+    for(uint32_t i = 0; i < FileSv.size(); i++) entry.file[i] = FileSv[i];
+
+    return entry;
+}
+
+template<typename Fmt>
+[[gnu::used, gnu::section("printfcheck_ids")]]
+inline constexpr auto FmtIdEntryOf = makeFmtIdEntry<Fmt>();
+
+/** ***************************************************************** **/
+/**       RUNTIME fmt validation: printfcheck::validate()             **/
+/** ***************************************************************** **/
+//  with ENABLE_FMT_VALIDATE the fmts that aren't literals, from tables
+// or catalogs, are checked at runtime with the rules of PRINTF_CHECK()
+#ifdef ENABLE_FMT_VALIDATE
+
+#ifndef FMT_VALIDATE_CACHE_SIZE
+#define FMT_VALIDATE_CACHE_SIZE             (1 << 14)       // entries, power of 2
+#endif
+
+namespace printfcheck
+{
+
+/** *****************************
+//  FmtValidation
+//  the result of a fmt with its argument types, what PRINTF_CHECK()
+//  would have said: isValid() is false where it fails to compile
+****************************** **/
+struct FmtValidation
+{
+    FmtError error      = FmtError::NoError;    // the first argument mismatch, or WarningFloatField
+    FmtError warning    = FmtError::NoError;    // WarningFieldValidity
+    uint32_t argCounter = 0;                    // the arguments of the fmt
+    uint32_t argsSize   = 0;                    // the arguments given
+    uint32_t offset     = 0;                    // of the field with 'error'
+
+    constexpr bool isValid() const
+    {
+        return argCounter <= argsSize && (error == FmtError::NoError || error == FmtError::WarningFloatField);
+    }
+
+    constexpr bool hasWarnings() const
+    {
+        return (EnableWarningTooMuchArguments == true && argsSize > argCounter) ||
+               (EnableFloatingCheck == true && error == FmtError::WarningFloatField) ||
+               (DisableFmtFieldValidity == false && warning != FmtError::NoError);
+    }
+};
+
+/** *****************************
+//  findFmtPercent()
+//  the next '%' of a fmt, or its end. 32 or 16 characters per step with
+//  AVX2 or SSE2. The loads are aligned, they don't cross a page past
+//  the end of the fmt
+****************************** **/
+[[gnu::no_sanitize_address]] inline
+const char*
+findFmtPercent(const char* text)
+{
+#if defined(__AVX2__)
+    const __m256i percent  = _mm256_set1_epi8('%');
+    const __m256i zero     = _mm256_setzero_si256();
+    uintptr_t     misalign = (uintptr_t)text & 31;
+    const char*   block    = text - misalign;
+
+    for(uint32_t skip = (uint32_t)misalign; ; block += 32, skip = 0)
+    {
+        __m256i  chars = _mm256_load_si256((const __m256i*)block);
+        uint32_t mask  = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chars, percent),
+                                                                         _mm256_cmpeq_epi8(chars, zero)));
+        mask >>= skip;
+        if (mask != 0) return block + skip + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    const __m128i percent  = _mm_set1_epi8('%');
+    const __m128i zero     = _mm_setzero_si128();
+    uintptr_t     misalign = (uintptr_t)text & 15;
+    const char*   block    = text - misalign;
+
+    for(uint32_t skip = (uint32_t)misalign; ; block += 16, skip = 0)
+    {
+        __m128i  chars = _mm_load_si128((const __m128i*)block);
+        uint32_t mask  = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, percent),
+                                                                  _mm_cmpeq_epi8(chars, zero)));
+        mask >>= skip;
+        if (mask != 0) return block + skip + __builtin_ctz(mask);
+    }
+#else
+    const char* percent = strchr(text, '%');
+    return percent != nullptr ? percent : text + strlen(text);
+#endif
+}
+
+/** *****************************
+//  validateFmt()
+//  parseFmtFields() and checkFmt() at runtime, on a C string: the same
+//  fields, the same checkFmtFieldArgs()
+****************************** **/
+inline
+FmtValidation
+validateFmt(const char* fmt, const FmtArgDesc* args, uint32_t argsSize)
+{
+    FmtValidation result;
+    result.argsSize = argsSize;
+
+    bool isChecking = true;     // until an invalid field, as countFmtArgs() and checkFmtArgs()
+
+    for(const char* text = findFmtPercent(fmt); *text == '%'; )
+    {
+        const char* start = text++;
+
+        // '%%' is the '%' character, not a field
+        if (*text == '%')
+        {
+            text = findFmtPercent(text + 1);
+            continue;
+        }
+
+        // the end of the fmt isn't a specifier
+        while(isFmtCharClass(*text, FmtClassSpecifier) == true) text++;
+
+        if (*text == '\0') break;
+
+        if (isFmtCharClass(*text, FmtClassConversion) == false)
+        {
+            text = findFmtPercent(text);
+            continue;
+        }
+
+        FmtFieldDesc field = makeFmtFieldDesc(std::string_view(start, (std::size_t)(text - start + 1)), (uint32_t)(start - fmt));
+
+        if (field.isValid == false)
+        {
+            result.warning = FmtError::WarningFieldValidity;
+            isChecking     = false;
+        }
+
+        if (isChecking == true)
+        {
+            if (result.argCounter < argsSize && result.error == FmtError::NoError)
+            {
+                result.error  = checkFmtFieldArgs(field, args, argsSize, result.argCounter);
+                result.offset = field.offset;
             }
-            else
+
+            result.argCounter += 1 + field.starCount;
+        }
+
+        text = findFmtPercent(text + 1);
+    }
+
+    if (result.error == FmtError::NoError) result.offset = 0;
+
+    return result;
+}
+
+/** *****************************
+//  FmtValidateCache
+//  the results by fmt pointer and argument types, lock-free: an entry
+//  is taken once with a CAS of 'fmt' and never changes, 'result' is
+//  published last. A full cache validates without caching. The fmts
+//  must not change while the program runs, like loaded tables
+****************************** **/
+inline constexpr uint32_t FmtValidateProbes = 16;
+inline constexpr uint64_t FmtValidateReady  = 1ULL << 63;
+
+// the offset has 15 bits in the packed result: a longer one isn't cached
+inline constexpr uint32_t FmtValidateMaxOffset = 0x7FFF;
+
+struct FmtValidateEntry
+{
+    std::atomic<const char*> fmt    { nullptr };
+    std::atomic<const void*> args   { nullptr };    // the FmtArgTable of the argument types
+    std::atomic<uint64_t>    result { 0 };          // packed FmtValidation | FmtValidateReady
+};
+
+static_assert((FMT_VALIDATE_CACHE_SIZE & (FMT_VALIDATE_CACHE_SIZE - 1)) == 0, "FMT_VALIDATE_CACHE_SIZE: a power of 2");
+
+inline FmtValidateEntry fmtValidateCache[FMT_VALIDATE_CACHE_SIZE];
+
+constexpr
+uint64_t
+packFmtValidation(const FmtValidation& result)
+{
+    return (uint64_t)makeFmtCheckResult(result.argCounter, result.error, result.warning) |
+           (uint64_t)(result.offset & FmtValidateMaxOffset) << 48 | FmtValidateReady;
+}
+
+constexpr
+FmtValidation
+unpackFmtValidation(uint64_t packed, uint32_t argsSize)
+{
+    FmtValidation result;
+
+    result.error      = getFmtErrorCode  ((FmtCheckResult)packed);
+    result.warning    = getFmtWarningCode((FmtCheckResult)packed);
+    result.argCounter = getFmtArgCounter ((FmtCheckResult)packed);
+    result.argsSize   = argsSize;
+    result.offset     = (uint32_t)(packed >> 48) & FmtValidateMaxOffset;
+
+    return result;
+}
+
+inline
+FmtValidation
+validateFmtCached(const char* fmt, const FmtArgDesc* args, uint32_t argsSize, const void* signature)
+{
+    uint64_t hash  = ((uint64_t)(uintptr_t)fmt ^ (uint64_t)(uintptr_t)signature * 31) * 0x9E3779B97F4A7C15ULL;
+    uint32_t index = (uint32_t)(hash >> 40);
+
+    for(uint32_t probe = 0; probe < FmtValidateProbes; probe++)
+    {
+        FmtValidateEntry& entry = fmtValidateCache[(index + probe) & (FMT_VALIDATE_CACHE_SIZE - 1)];
+        const char*       key   = entry.fmt.load(std::memory_order_acquire);
+
+        if (key == nullptr)
+        {
+            // the first call takes it, the others validate meanwhile
+            FmtValidation result = validateFmt(fmt, args, argsSize);
+
+            if (result.offset > FmtValidateMaxOffset) return result;
+
+            if (entry.fmt.compare_exchange_strong(key, fmt, std::memory_order_acq_rel) == true)
             {
-                /** *************** **/
-                /** Type Comparison **/
-                /** *************** **/
-                if (FmtField == "%s"sv) 
-                {
-                    if (isCharArray<TupleType>() == false)       return FmtError::ErrorString;
-                }
-                else if (FmtField == "%n"sv)
-                {
-                    if (isPointerToNumber<TupleType>() == false) return FmtError::ErrorNumber;
-                }
-                else if (isFieldANumber(FmtField) == true)
-                {
-                    if (isANumber<TupleType>() == false)         return FmtError::ErrorNumber;
-                
-                    if (EnableFloatingCheck == true && 
-                        isFieldAFloatingNumber(FmtField) == true && 
-                        std::is_floating_point_v< std::decay_t<TupleType> > == false)
-                    {
-                                                                 return FmtError::WarningFloatField;
-                    }
-                }
+                entry.args.store(signature, std::memory_order_relaxed);
+                entry.result.store(packFmtValidation(result), std::memory_order_release);
+                return result;
             }
         }
 
-        auto ret = constexpr_for_check_Field<NextStartIndex, End, NextSelectedIndex, TupleWithTypes>( func );
-        if(ret != FmtError::NoError) return ret;
-    }
+        if (key == fmt)
+        {
+            uint64_t packed = entry.result.load(std::memory_order_acquire);
+
+            if ((packed & FmtValidateReady) == 0)                                 return validateFmt(fmt, args, argsSize);
+            if (entry.args.load(std::memory_order_relaxed) == signature)          return unpackFmtValidation(packed, argsSize);
+        }
+    }
+
+    return validateFmt(fmt, args, argsSize);
+}
+
+/** *****************************
+//  validate()
+//  validate<int, const char*>(fmt), or validateArgs(fmt, args...) with
+//  the types of the arguments. The second call with the same fmt
+//  pointer and types is a lookup in the cache
+****************************** **/
+template<typename... Args>
+FmtValidation
+validate(const char* fmt)
+{
+    using ArgTable = FmtArgTable<FmtTypeList<Args...>>;
+
+    return validateFmtCached(fmt, ArgTable::value.data(), (uint32_t)sizeof...(Args), &ArgTable::value);
+}
+
+// the arguments are taken by value, like captureArgTypes()
+template<typename... Args>
+FmtValidation
+validateArgs(const char* fmt, Args... args)
+{
+    ((void)args, ...);
+    return validate<Args...>(fmt);
+}
+
+/** *****************************
+//  getFmtArgDescs()
+//  the argument types that a fmt takes, to check its translations: a
+//  number for '*', a string for "%s", a pointer for "%n", a floating
+//  number for "%f"... The fields after an invalid one are ignored
+****************************** **/
+inline
+std::vector<FmtArgDesc>
+getFmtArgDescs(const char* fmt)
+{
+    std::vector<FmtArgDesc> args;
+
+    for(const char* text = findFmtPercent(fmt); *text == '%'; )
+    {
+        const char* start = text++;
+
+        if (*text == '%')
+        {
+            text = findFmtPercent(text + 1);
+            continue;
+        }
+
+        while(isFmtCharClass(*text, FmtClassSpecifier) == true) text++;
+
+        if (*text == '\0') break;
+
+        if (isFmtCharClass(*text, FmtClassConversion) == false)
+        {
+            text = findFmtPercent(text);
+            continue;
+        }
+
+        FmtFieldDesc field = makeFmtFieldDesc(std::string_view(start, (std::size_t)(text - start + 1)), (uint32_t)(start - fmt));
+        if (field.isValid == false) break;
+
+        FmtArgDesc number = {};
+        number.isNumber = true;
+
+        for(uint32_t i = 0; i < field.starCount; i++) args.push_back(number);
+
+        FmtArgDesc arg = number;
+        if (field.conversion == 's')
+        {
+            arg = {};
+            arg.isCharArray = true;
+        }
+        else if (field.conversion == 'n')
+        {
+            arg = {};
+            arg.isPointerToNumber = true;
+        }
+        else
+        {
+            arg.isFloatingPoint = isFieldAFloatingNumber(field.conversion);
+        }
+
+        args.push_back(arg);
+        text = findFmtPercent(text + 1);
+    }
+
+    return args;
+}
+
+/** *****************************
+//  validateCatalog()
+//  every fmt of a catalog with its argument types, by all the cores:
+//  the catalog is cut in chunks, each thread takes the chunks of its
+//  range from the front and steals from the back of the others when
+//  it's done. The report keeps the failed fmts only, by index
+****************************** **/
+struct FmtCatalogEntry
+{
+    const char*       fmt      = nullptr;
+    const FmtArgDesc* args     = nullptr;
+    uint32_t          argsSize = 0;
+};
+
+struct FmtCatalogError
+{
+    uint32_t      index  = 0;
+    FmtValidation result = {};
+};
+
+struct FmtCatalogReport
+{
+    size_t                       validated = 0;
+    size_t                       warnings  = 0;     // in 'errors' with 'isWithWarnings'
+    std::vector<FmtCatalogError> errors;            // by index
+};
+
+inline constexpr uint32_t FmtCatalogChunkSize = 256;
+
+// a range of chunks: the front in the high half, the back in the low half
+struct alignas(64) FmtCatalogRange
+{
+    std::atomic<uint64_t> range { 0 };
+};
+
+inline
+bool
+takeFmtCatalogChunk(FmtCatalogRange& worker, bool isOwner, uint32_t& chunk)
+{
+    uint64_t range = worker.range.load(std::memory_order_relaxed);
+
+    while(true)
+    {
+        uint32_t front = (uint32_t)(range >> 32);
+        uint32_t back  = (uint32_t)range;
+
+        if (front >= back) return false;
+
+        uint64_t next = isOwner == true ? ((uint64_t)(front + 1) << 32 | back) : ((uint64_t)front << 32 | (back - 1));
+
+        if (worker.range.compare_exchange_weak(range, next, std::memory_order_relaxed) == true)
+        {
+            chunk = isOwner == true ? front : back - 1;
+            return true;
+        }
+    }
+}
+
+constexpr
+const char*
+getFmtErrorText(FmtError error)
+{
+    switch(error)
+    {
+        case FmtError::NoError:              return "no error";
+        case FmtError::ErrorString:          return "it isn't a char*";
+        case FmtError::ErrorNumber:          return "it isn't a number";
+        case FmtError::ErrorCharArray:       return "'%.*s' arguments";
+        case FmtError::ErrorWidthVariable:   return "'%*' width arguments";
+        case FmtError::WarningFieldValidity: return "fields aren't conformant";
+        case FmtError::WarningFloatField:    return "float warning";
+    }
+
+    return "unknown";
+}
+
+inline
+FmtCatalogReport
+validateCatalog(const FmtCatalogEntry* entries, size_t size, uint32_t threadCount = 0, bool isWithWarnings = false)
+{
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    uint32_t chunks = (uint32_t)((size + FmtCatalogChunkSize - 1) / FmtCatalogChunkSize);
+    threadCount     = std::max(1u, std::min(threadCount, chunks));
+
+    std::unique_ptr<FmtCatalogRange[]>           ranges(new FmtCatalogRange[threadCount]);
+    std::vector<std::vector<FmtCatalogError>>    errors(threadCount);
+    std::vector<size_t>                          warnings(threadCount);
+
+    for(uint32_t t = 0; t < threadCount; t++)
+    {
+        uint64_t front = (uint64_t)chunks * t / threadCount;
+        uint64_t back  = (uint64_t)chunks * (t + 1) / threadCount;
+        ranges[t].range.store(front << 32 | back, std::memory_order_relaxed);
+    }
+
+    auto worker = [&](uint32_t self)
+    {
+        uint32_t chunk = 0;
+
+        for(uint32_t victim = self; ; )
+        {
+            if (takeFmtCatalogChunk(ranges[victim], victim == self, chunk) == false)
+            {
+                // its own range is done: the others, from the back
+                victim = (victim + 1) % threadCount;
+                if (victim == self) break;
+                continue;
+            }
+
+            size_t end = std::min(size, (size_t)(chunk + 1) * FmtCatalogChunkSize);
+
+            for(size_t i = (size_t)chunk * FmtCatalogChunkSize; i < end; i++)
+            {
+                FmtValidation result = validateFmt(entries[i].fmt, entries[i].args, entries[i].argsSize);
+                bool          isWarn = isWithWarnings == true && result.isValid() == true && result.hasWarnings() == true;
+
+                if (result.isValid() == false || isWarn == true) errors[self].push_back({ (uint32_t)i, result });
+                if (isWarn == true)                              warnings[self]++;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(uint32_t t = 1; t < threadCount; t++) threads.emplace_back(worker, t);
+    worker(0);
+    for(auto& thread : threads) thread.join();
+
+    FmtCatalogReport report;
+    report.validated = size;
+
+    for(uint32_t t = 0; t < threadCount; t++)
+    {
+        report.warnings += warnings[t];
+        report.errors.insert(report.errors.end(), errors[t].begin(), errors[t].end());
+    }
+
+    std::sort(report.errors.begin(), report.errors.end(),
+              [](const FmtCatalogError& a, const FmtCatalogError& b) { return a.index < b.index; });
+
+    return report;
+}
+
+// a line per failed fmt: "index: offset: error: fmt"
+inline
+void
+dumpFmtCatalogReport(const FmtCatalogReport& report, const FmtCatalogEntry* entries, FILE* file = stderr)
+{
+    for(const FmtCatalogError& error : report.errors)
+    {
+        const FmtValidation& result = error.result;
+        const char*          text   = result.argCounter > result.argsSize  ? "too few arguments"  :
+                                      result.error != FmtError::NoError     ? getFmtErrorText(result.error) :
+                                      result.argsSize > result.argCounter  ? "too many arguments" : getFmtErrorText(result.warning);
+
+        (fprintf)(file, "%u: %u: %s: \"%.*s\"\n", error.index, result.offset, text,
+                (int)strcspn(entries[error.index].fmt, "\n"), entries[error.index].fmt);
+    }
+
+    (fprintf)(file, "%zu fmts, %zu errors, %zu warnings\n", report.validated, report.errors.size() - report.warnings, report.warnings);
+}
+
+} // namespace printfcheck
+
+#endif /** ENABLE_FMT_VALIDATE **/
+
+/** ***************************************************************** **/
+/**       RUNTIME std::string arguments: ENABLE_PRINTF_STRING         **/
+/** ***************************************************************** **/
+#ifdef ENABLE_PRINTF_STRING
+
+enum class FmtStringArgKind : uint8_t
+{
+    Value,          // the argument of the call
+    Fmt,            // the rewritten fmt
+    Precision,      // (int)size() of a string, up to the precision of its field
+    Data,           // data() of a string
+};
+
+inline constexpr uint32_t FmtStringNoIndex = 0xFFFFFFFF;
+
+struct FmtStringArgDesc
+{
+    FmtStringArgKind kind           = FmtStringArgKind::Value;
+    uint32_t         index          = 0;                    // in the arguments of the call
+    int32_t          precision      = -1;                   // written precision of the field
+    uint32_t         precisionIndex = FmtStringNoIndex;     // the argument of its ".*"
+};
+
+template<uint32_t FmtSize, uint32_t ArgsSize>
+struct FmtStringLayout
+{
+    std::array<char, FmtSize + 1>           fmt  = {};
+    std::array<FmtStringArgDesc, ArgsSize>  args = {};
+};
+
+struct FmtStringSizes
+{
+    uint32_t fmtSize  = 0;
+    uint32_t argsSize = 0;
+};
+
+/** *****************************
+//  buildFmtString()
+//  the fmt with every "%s" of a string as "%.*s", the flags and the
+//  width kept, and the arguments of the call: (int)size() and data()
+//  for the string. Only the sizes when 'fmt' and 'args' are null
+****************************** **/
+template<uint32_t MaxFields>
+constexpr
+FmtStringSizes
+buildFmtString(std::string_view fmtSv, const FmtFieldTable<MaxFields>& table, const bool* isString, uint32_t argsSize,
+               uint32_t leading, char* fmt, FmtStringArgDesc* args)
+{
+    FmtStringSizes sizes = {};
+
+    auto addText = [&](std::string_view text)
+    {
+        for(char c : text)
+        {
+            if (fmt != nullptr) fmt[sizes.fmtSize] = c;
+            sizes.fmtSize++;
+        }
+    };
+
+    auto addArg = [&](FmtStringArgKind kind, uint32_t index, int32_t precision = -1, uint32_t precisionIndex = FmtStringNoIndex)
+    {
+        if (args != nullptr) args[sizes.argsSize] = FmtStringArgDesc{ kind, index, precision, precisionIndex };
+        sizes.argsSize++;
+    };
+
+    // FILE*, buffer, size... and the fmt
+    for(uint32_t i = 0; i < leading; i++) addArg(FmtStringArgKind::Value, i);
+    addArg(FmtStringArgKind::Fmt, leading);
+
+    uint32_t ArgIndex = leading + 1;
+    uint32_t Index    = 0;
+
+    // the fields after a non-conformant one are left as they are
+    for(uint32_t i = 0; i < table.size && table.fields[i].isValid == true; i++)
+    {
+        const FmtFieldDesc& Field       = table.fields[i];
+        uint32_t            StringIndex = ArgIndex + Field.starCount;
+
+        addText(fmtSv.substr(Index, Field.offset - Index));
+        Index = Field.offset + Field.size;
+
+        if (Field.conversion != 's' || StringIndex >= argsSize || isString[StringIndex] == false)
+        {
+            addText(fmtSv.substr(Field.offset, Field.size));
+            for(uint32_t j = 0; j <= Field.starCount && ArgIndex < argsSize; j++) addArg(FmtStringArgKind::Value, ArgIndex++);
+            continue;
+        }
+
+        // '%', the flags and the width: the precision and the length are replaced
+        std::string_view FieldSv         = fmtSv.substr(Field.offset, Field.size);
+        std::string_view WidthSv         = FieldSv.substr(0, FieldSv.find_first_of(".hlzjtLs"));
+        bool             isWidthStar     = WidthSv.find('*') != std::string_view::npos;
+        bool             isPrecisionStar = Field.starCount > (isWidthStar == true ? 1 : 0);
+
+        addText(WidthSv);
+        addText(".*s");
+
+        if (isWidthStar == true) addArg(FmtStringArgKind::Value, ArgIndex);
+        addArg(FmtStringArgKind::Precision, StringIndex, Field.precision, isPrecisionStar == true ? StringIndex - 1 : FmtStringNoIndex);
+        addArg(FmtStringArgKind::Data, StringIndex);
+
+        ArgIndex = StringIndex + 1;
+    }
+
+    addText(fmtSv.substr(Index));
+    while(ArgIndex < argsSize) addArg(FmtStringArgKind::Value, ArgIndex++);
+
+    return sizes;
+}
+
+template<typename Fmt, uint32_t Leading, typename... Args>
+CONSTEVAL
+auto
+makeFmtStringLayout()
+{
+    constexpr std::string_view FmtSv      = Fmt::value();
+    constexpr auto             Table      = parseFmtFields<FmtSv.size() / 2>(FmtSv);
+    constexpr bool             IsString[] = { isFmtString<Args>()..., false };
+    constexpr FmtStringSizes   Sizes      = buildFmtString(FmtSv, Table, IsString, sizeof...(Args), Leading, nullptr, nullptr);
+
+    FmtStringLayout<Sizes.fmtSize, Sizes.argsSize> layout = {};
+    buildFmtString(FmtSv, Table, IsString, sizeof...(Args), Leading, layout.fmt.data(), layout.args.data());
+
+    return layout;
+}
+
+template<typename Fmt, uint32_t Leading, typename... Args>
+inline constexpr auto FmtStringLayoutOf = makeFmtStringLayout<Fmt, Leading, Args...>();
+
+//  helper: getFmtPackArg(), the argument I of the call
+template<std::size_t I, typename First, typename... Rest>
+inline
+constexpr
+decltype(auto)
+getFmtPackArg(First& first, Rest&... rest)
+{
+    if constexpr (I == 0) return (first);
+    else                  return getFmtPackArg<I - 1>(rest...);
+}
+
+//  helper: getFmtCallArg(), an argument as the call expects it. The
+// arguments are taken by const& to bind bit-fields, the buffer of
+// sprintf() is a char array again
+template<typename T>
+inline
+constexpr
+decltype(auto)
+getFmtCallArg(const T& arg)
+{
+    if constexpr (std::is_array_v<T> == true) return const_cast<std::remove_const_t<std::remove_extent_t<T>>*>(arg);
+    else                                      return (arg);
+}
+
+template<FmtStringArgKind Kind, uint32_t Index, int32_t Precision, uint32_t PrecisionIndex, typename... Args>
+inline
+decltype(auto)
+getFmtStringArg(const char* fmt, Args&... args)
+{
+    if constexpr (Kind == FmtStringArgKind::Fmt)
+    {
+        return fmt;
+    }
+    else if constexpr (Kind == FmtStringArgKind::Data)
+    {
+        return getFmtPackArg<Index>(args...).data();
+    }
+    else if constexpr (Kind == FmtStringArgKind::Precision)
+    {
+        std::size_t size = getFmtPackArg<Index>(args...).size();
+
+        if constexpr (Precision >= 0)
+        {
+            if ((std::size_t)Precision < size) size = (std::size_t)Precision;
+        }
+
+        // a negative ".*" is no precision
+        if constexpr (PrecisionIndex != FmtStringNoIndex)
+        {
+            int precision = (int)getFmtPackArg<PrecisionIndex>(args...);
+            if (precision >= 0 && (std::size_t)precision < size) size = (std::size_t)precision;
+        }
+
+        return (int)(size < 0x7FFFFFFF ? size : 0x7FFFFFFF);
+    }
+    else
+    {
+        return getFmtCallArg(getFmtPackArg<Index>(args...));
+    }
+}
+
+template<typename Fmt, uint32_t Leading, typename Print, std::size_t... J, typename... Args>
+inline
+int
+printfStringArgs(Print print, std::index_sequence<J...>, const Args&... args)
+{
+    constexpr auto& Layout = FmtStringLayoutOf<Fmt, Leading, Args...>;
+
+    return print(getFmtStringArg<Layout.args[J].kind, Layout.args[J].index,
+                                 Layout.args[J].precision, Layout.args[J].precisionIndex>(Layout.fmt.data(), args...)...);
+}
+
+// the types are from captureArgTypes(), the leading arguments included
+template<typename... Args>
+CONSTEVAL
+bool
+hasFmtStringArg(FmtTypeList<Args...>)
+{
+    return (isFmtString<Args>() || ...);
+}
+
+/** *****************************
+//  printfString()
+//  the call of a wrapper, 'print' is printf(), fprintf()... The fmt
+//  of a call with strings is rewritten at compile-time, they are
+//  passed as (int)size() and data(): no copy, no strlen()
+****************************** **/
+template<typename Fmt, uint32_t Leading, typename Print, typename... Args>
+inline
+int
+printfString(Print print, const Args&... args)
+{
+    if constexpr ((isFmtString<Args>() || ...) == false)
+        return print(getFmtCallArg(args)...);
+    else
+        return printfStringArgs<Fmt, Leading>(print, std::make_index_sequence<FmtStringLayoutOf<Fmt, Leading, Args...>.args.size()>{},
+                                              args...);
+}
+
+#endif /** ENABLE_PRINTF_STRING **/
+
+/** ***************************************************************** **/
+/**       RUNTIME fast path: PRINTF_FAST()                            **/
+/** ***************************************************************** **/
+
+// output size of a fast call, a longer output goes through printf()
+inline constexpr uint32_t FmtFastBufferSize  = 1024;
+
+// the longest integer without width: 20 digits of UINT64_MAX or '-' + 19
+inline constexpr uint32_t FmtFastIntegerSize = 20;
+
+inline constexpr std::string_view
+FmtFastConversionList = { "diuxXsc" };
+
+/** *****************************
+//  FmtFastLayout
+//  the fmt without its fields: the '%%' are already a single '%', and
+//  the text before each field is a fixed-size copy from 'text'
+****************************** **/
+template<uint32_t MaxFields, uint32_t FmtSize>
+struct FmtFastLayout
+{
+    FmtFieldTable<MaxFields>         table         = {};
+    std::array<char, FmtSize + 1>    text          = {};
+    uint32_t                         segmentOffset[MaxFields + 1] = {};
+    uint32_t                         segmentSize  [MaxFields + 1] = {};
+    uint32_t                         fixedSize     = 0;     // text + every field but '%s'
+    bool                             isSupported   = true;
+};
+
+//  helper: isFmtFastField()
+constexpr bool
+isFmtFastField(const FmtFieldDesc& field)
+{
+    bool isText    = (field.conversion == 's' || field.conversion == 'c');
+    bool isInteger = (isText == false);
+
+    if (field.isValid == false || field.starCount > 0 || field.precision >= 0)
+        return false;
+
+    if (FmtFastConversionList.find(field.conversion) == std::string_view::npos)
+        return false;
+
+    // '+' and '#' are left to printf(), '0' is only for integers
+    if ((field.flags & ~(FmtFlagMinus | FmtFlagZero)) != 0 ||
+        (isText == true && (field.flags & FmtFlagZero) != 0))
+        return false;
+
+    // "%ls", "%lc" and "%Ld" are left to printf()
+    if ((isText == true  && field.length != FmtLength::None) ||
+        (isInteger == true && field.length == FmtLength::L))
+        return false;
+
+    return true;
+}
+
+//  helper: getFmtFastFixedSize(), the room of a field but '%s'
+constexpr uint32_t
+getFmtFastFixedSize(const FmtFieldDesc& field)
+{
+    if (field.conversion == 's') return 0;
+    if (field.conversion == 'c') return field.width > 1 ? field.width : 1;
+
+    return field.width > FmtFastIntegerSize ? field.width : FmtFastIntegerSize;
+}
+
+template<typename Fmt>
+CONSTEVAL
+auto
+makeFmtFastLayout()
+{
+    constexpr std::string_view FmtSv = Fmt::value();
+
+    FmtFastLayout<FmtSv.size() / 2, FmtSv.size()> layout = {};
+
+    layout.table = parseFmtFields<FmtSv.size() / 2>(FmtSv);
+
+    uint32_t TextSize   = 0;
+    uint32_t FieldIndex = 0;
+
+    for(uint32_t Index = 0; Index < FmtSv.size(); )
+    {
+        if (FmtSv[Index] != '%')
+        {
+            layout.text[TextSize++] = FmtSv[Index++];
+            continue;
+        }
+
+        if (Index + 1 < FmtSv.size() && FmtSv[Index + 1] == '%')
+        {
+            layout.text[TextSize++] = '%';
+            Index += 2;
+            continue;
+        }
+
+        // a '%' that isn't a field: unknown conversion or at the end of the fmt
+        if (FieldIndex >= layout.table.size || layout.table.fields[FieldIndex].offset != Index)
+        {
+            layout.isSupported = false;
+            return layout;
+        }
+
+        const FmtFieldDesc& Field = layout.table.fields[FieldIndex];
+
+        if (isFmtFastField(Field) == false) layout.isSupported = false;
+
+        layout.fixedSize += getFmtFastFixedSize(Field);
+
+        layout.segmentSize[FieldIndex]       = TextSize - layout.segmentOffset[FieldIndex];
+        layout.segmentOffset[FieldIndex + 1] = TextSize;
+
+        Index += Field.size;
+        FieldIndex++;
+    }
+
+    layout.segmentSize[FieldIndex] = TextSize - layout.segmentOffset[FieldIndex];
+    layout.fixedSize += TextSize;
+
+    if (layout.fixedSize > FmtFastBufferSize) layout.isSupported = false;
+
+    return layout;
+}
+
+template<typename Fmt>
+inline constexpr auto FmtFastLayoutOf = makeFmtFastLayout<Fmt>();
+
+// only the text is used at runtime, the rest of the layout isn't emitted
+template<typename Fmt>
+inline constexpr auto FmtFastTextOf = FmtFastLayoutOf<Fmt>.text;
+
+/** *****************************
+//  isFmtFastSupported()
+//  the fields and also the types of the arguments: an integer field
+//  with a floating point argument is left to printf()
+****************************** **/
+template<typename Fmt, typename... Args>
+CONSTEVAL
+bool
+isFmtFastSupported()
+{
+    constexpr auto& Layout = FmtFastLayoutOf<Fmt>;
+
+    if (Layout.isSupported == false || Layout.table.size != sizeof...(Args))
+        return false;
+
+    constexpr bool IsStringArg[]  = { isCharArray<Args>()..., false };
+    constexpr bool IsIntegerArg[] = { (std::is_integral_v<std::decay_t<Args>> ||
+                                       std::is_enum_v<std::decay_t<Args>>)..., false };
+
+    for(uint32_t i = 0; i < Layout.table.size; i++)
+    {
+        bool isStringField = (Layout.table.fields[i].conversion == 's');
+
+        if (isStringField == true  && IsStringArg[i]  == false) return false;
+        if (isStringField == false && IsIntegerArg[i] == false) return false;
+    }
+
+    return true;
+}
+
+/** *****************************
+//  conversions, the same output as glibc
+****************************** **/
+inline constexpr char FmtFastDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+//  the argument is read as the type printf() would read: "%hhd" is a signed char
+template<char Conversion, FmtLength Length, typename T>
+inline
+constexpr
+uint64_t
+getFmtFastMagnitude(T arg, bool& isNegative)
+{
+    if constexpr (Conversion == 'd' || Conversion == 'i')
+    {
+        int64_t value = 0;
+
+        if      constexpr (Length == FmtLength::hh) value = (signed char)arg;
+        else if constexpr (Length == FmtLength::h)  value = (short)arg;
+        else if constexpr (Length == FmtLength::l)  value = (long)arg;
+        else if constexpr (Length == FmtLength::ll) value = (long long)arg;
+        else if constexpr (Length == FmtLength::j)  value = (intmax_t)arg;
+        else if constexpr (Length == FmtLength::z)  value = (std::make_signed_t<size_t>)arg;
+        else if constexpr (Length == FmtLength::t)  value = (std::ptrdiff_t)arg;
+        else                                        value = (int)arg;
+
+        isNegative = (value < 0);
+        return isNegative ? 0 - (uint64_t)value : (uint64_t)value;
+    }
+    else
+    {
+        isNegative = false;
+
+        if      constexpr (Length == FmtLength::hh) return (unsigned char)arg;
+        else if constexpr (Length == FmtLength::h)  return (unsigned short)arg;
+        else if constexpr (Length == FmtLength::l)  return (unsigned long)arg;
+        else if constexpr (Length == FmtLength::ll) return (unsigned long long)arg;
+        else if constexpr (Length == FmtLength::j)  return (uintmax_t)arg;
+        else if constexpr (Length == FmtLength::z)  return (size_t)arg;
+        else if constexpr (Length == FmtLength::t)  return (std::make_unsigned_t<std::ptrdiff_t>)arg;
+        else                                        return (unsigned int)arg;
+    }
+}
+
+inline
+char*
+writeFmtFastPadding(char* out, char c, uint32_t size)
+{
+    memset(out, c, size);
+    return out + size;
+}
+
+inline
+char*
+writeFmtFastInteger(char* out, uint64_t magnitude, bool isNegative, char conversion, uint8_t flags, uint32_t width)
+{
+    char  digits[FmtFastIntegerSize];
+    char* end   = digits + sizeof(digits);
+    char* begin = end;
+
+    if (conversion == 'x' || conversion == 'X')
+    {
+        const char* hex = (conversion == 'x') ? "0123456789abcdef" : "0123456789ABCDEF";
+
+        do { *--begin = hex[magnitude & 0xF]; magnitude >>= 4; } while(magnitude != 0);
+    }
+    else
+    {
+        // two digits per division
+        while(magnitude >= 100)
+        {
+            uint32_t pair = (uint32_t)(magnitude % 100) * 2;
+            magnitude /= 100;
+            *--begin = FmtFastDigitPairs[pair + 1];
+            *--begin = FmtFastDigitPairs[pair];
+        }
+
+        if (magnitude >= 10)
+        {
+            *--begin = FmtFastDigitPairs[magnitude * 2 + 1];
+            *--begin = FmtFastDigitPairs[magnitude * 2];
+        }
+        else
+        {
+            *--begin = (char)('0' + magnitude);
+        }
+    }
+
+    uint32_t size    = (uint32_t)(end - begin) + (isNegative ? 1 : 0);
+    uint32_t padding = width > size ? width - size : 0;
+
+    if ((flags & FmtFlagMinus) == 0 && (flags & FmtFlagZero) == 0)
+        out = writeFmtFastPadding(out, ' ', padding);
+
+    if (isNegative == true) *out++ = '-';
+
+    if ((flags & FmtFlagMinus) == 0 && (flags & FmtFlagZero) != 0)
+        out = writeFmtFastPadding(out, '0', padding);
+
+    memcpy(out, begin, end - begin);
+    out += end - begin;
+
+    if ((flags & FmtFlagMinus) != 0)
+        out = writeFmtFastPadding(out, ' ', padding);
+
+    return out;
+}
+
+inline
+char*
+writeFmtFastText(char* out, const char* text, size_t size, uint8_t flags, uint32_t width)
+{
+    uint32_t padding = width > size ? width - (uint32_t)size : 0;
+
+    if ((flags & FmtFlagMinus) == 0) out = writeFmtFastPadding(out, ' ', padding);
+
+    memcpy(out, text, size);
+    out += size;
+
+    if ((flags & FmtFlagMinus) != 0) out = writeFmtFastPadding(out, ' ', padding);
+
+    return out;
+}
+
+/** *****************************
+//  formatFmtFast()
+//  the fields are written one after the other in a stack buffer, with
+//  the field descriptors as constants. The integers and characters fit
+//  always, the room left for the strings is checked. The room of the
+//  fixed text and fields is given back to the strings once written
+****************************** **/
+struct FmtFastWriter
+{
+    char* out        = nullptr;
+    char* limit      = nullptr;     // end of the buffer - the fixed sizes still to write
+    bool  isOverflow = false;
+};
+
+template<typename Fmt, uint32_t Segment>
+inline
+void
+writeFmtFastSegment(FmtFastWriter& writer)
+{
+    constexpr auto&    Layout = FmtFastLayoutOf<Fmt>;
+    constexpr uint32_t Size   = Layout.segmentSize[Segment];
+
+    if constexpr (Size > 0)
+    {
+        memcpy(writer.out, FmtFastTextOf<Fmt>.data() + Layout.segmentOffset[Segment], Size);
+        writer.out   += Size;
+        writer.limit += Size;
+    }
+}
+
+template<typename Fmt, uint32_t I, typename T>
+inline
+void
+writeFmtFastField(FmtFastWriter& writer, T arg)
+{
+    constexpr FmtFieldDesc Field     = FmtFastLayoutOf<Fmt>.table.fields[I];
+    constexpr uint32_t     FixedSize = getFmtFastFixedSize(Field);
+
+    writeFmtFastSegment<Fmt, I>(writer);
+    writer.limit += FixedSize;
+
+    if constexpr (Field.conversion == 's')
+    {
+        const char* text = (arg != nullptr) ? (const char*)arg : "(null)";
+        size_t      size = strlen(text);
+
+        if (writer.isOverflow == true || writer.limit - writer.out < (std::ptrdiff_t)(size + Field.width))
+        {
+            writer.isOverflow = true;
+            return;
+        }
+
+        writer.out = writeFmtFastText(writer.out, text, size, Field.flags, Field.width);
+    }
+    else if constexpr (Field.conversion == 'c')
+    {
+        char c = (char)(unsigned char)(int)arg;
+
+        writer.out = writeFmtFastText(writer.out, &c, 1, Field.flags, Field.width);
+    }
+    else
+    {
+        bool     isNegative = false;
+        uint64_t magnitude  = getFmtFastMagnitude<Field.conversion, Field.length>(arg, isNegative);
+
+        writer.out = writeFmtFastInteger(writer.out, magnitude, isNegative, Field.conversion, Field.flags, Field.width);
+    }
+}
+
+template<typename Fmt, std::size_t... I, typename... Args>
+inline
+void
+writeFmtFastFields(FmtFastWriter& writer, std::index_sequence<I...>, Args... args)
+{
+    (writeFmtFastField<Fmt, (uint32_t)I>(writer, args), ...);
+}
+
+//  returns the output size, or -1 when the strings don't fit in the buffer
+template<typename Fmt, typename... Args>
+inline
+int
+formatFmtFast(char (&buffer)[FmtFastBufferSize], Args... args)
+{
+    constexpr auto& Layout = FmtFastLayoutOf<Fmt>;
+
+    FmtFastWriter writer = {};
+    writer.out   = buffer;
+    writer.limit = buffer + FmtFastBufferSize - Layout.fixedSize;
+
+    writeFmtFastFields<Fmt>(writer, std::index_sequence_for<Args...>{}, args...);
+    writeFmtFastSegment<Fmt, Layout.table.size>(writer);
+
+    if (writer.isOverflow == true) return -1;
+
+    return (int)(writer.out - buffer);
+}
+
+/** *****************************
+//  fprintfFast(), snprintfFast()
+//  one fwrite() of the formatted buffer. Unsupported fmts, argument
+//  types and too long outputs are printed by printf() itself
+****************************** **/
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-security"
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+
+template<typename Fmt, typename... Args>
+inline
+int
+fprintfFast(FILE* file, const char* fmt, Args... args)
+{
+    if constexpr (isFmtFastSupported<Fmt, Args...>() == true)
+    {
+        char buffer[FmtFastBufferSize];
+        int  size = formatFmtFast<Fmt>(buffer, args...);
+
+        if (size >= 0)
+            return fwrite(buffer, 1, size, file) == (size_t)size ? size : -1;
+    }
+
+#ifdef ENABLE_PRINTF_STRING
+    return printfString<Fmt, 1>(&fprintf, file, fmt, args...);
+#else
+    return (fprintf)(file, fmt, args...);
+#endif
+}
+
+template<typename Fmt, typename... Args>
+inline
+int
+snprintfFast(char* dest, size_t destSize, const char* fmt, Args... args)
+{
+    if constexpr (isFmtFastSupported<Fmt, Args...>() == true)
+    {
+        char buffer[FmtFastBufferSize];
+        int  size = formatFmtFast<Fmt>(buffer, args...);
+
+        if (size >= 0)
+        {
+            if (destSize > 0)
+            {
+                size_t copySize = (size_t)size < destSize ? (size_t)size : destSize - 1;
+                memcpy(dest, buffer, copySize);
+                dest[copySize] = '\0';
+            }
+            return size;
+        }
+    }
+
+#ifdef ENABLE_PRINTF_STRING
+    return printfString<Fmt, 2>(&snprintf, dest, destSize, fmt, args...);
+#else
+    return (snprintf)(dest, destSize, fmt, args...);
+#endif
+}
+
+/** *****************************
+//  printfToStack()
+//  PRINTF_TO_STACK(): the output in a buffer of the caller's frame,
+//  sized by the bound of the fmt, so it's never truncated
+****************************** **/
+template<uint32_t MaxSize>
+struct FmtStackString
+{
+    char     buffer[MaxSize + 1];
+    uint32_t size;
+
+    const char*      c_str() const { return buffer; }
+    std::string_view view()  const { return std::string_view(buffer, size); }
+};
+
+// an unbounded fmt fails in printfToStack(), not in the size of the buffer
+template<typename Fmt>
+using FmtStackStringOf = FmtStackString<FmtMaxSizeOf<Fmt> != FmtSizeUnbounded ? FmtMaxSizeOf<Fmt> : 0>;
+
+// the bound holds only for valid fields, one argument each
+template<typename Fmt>
+CONSTEVAL
+bool
+isFmtStackFieldsValid()
+{
+    constexpr std::string_view FmtSv = Fmt::value();
+    constexpr auto             Table = parseFmtFields<FmtSv.size() / 2>(FmtSv);
+
+    for(uint32_t i = 0; i < Table.size; i++)
+    {
+        if (Table.fields[i].isValid == false) return false;
+    }
+
+    return true;
+}
+
+template<typename Fmt, typename... Args>
+inline
+FmtStackStringOf<Fmt>
+printfToStack(const char* fmt, Args... args)
+{
+    constexpr std::string_view FmtSv = Fmt::value();
+
+    static_assert(FmtMaxSizeOf<Fmt> != FmtSizeUnbounded,
+                  "PRINTF_TO_STACK() needs a bounded fmt: a precision for '%s', no '*' nor '%L' floats");
+    static_assert(isFmtStackFieldsValid<Fmt>() == true,
+                  "PRINTF_TO_STACK() needs conformant fmt fields");
+    static_assert(countFmtArgs(parseFmtFields<FmtSv.size() / 2>(FmtSv)) == sizeof...(Args),
+                  "PRINTF_TO_STACK() needs one argument per fmt field");
+
+    FmtStackStringOf<Fmt> result;
+    int size = snprintfFast<Fmt>(result.buffer, sizeof(result.buffer), fmt, args...);
+
+    // an encoding error of "%lc"
+    if (size < 0)
+    {
+        result.buffer[0] = '\0';
+        size = 0;
+    }
+
+    // snprintf() returns the untruncated size: never above the buffer
+    result.size = (uint32_t)size < sizeof(result.buffer) ? (uint32_t)size : (uint32_t)sizeof(result.buffer) - 1;
+    return result;
+}
+
+#pragma GCC diagnostic pop
+
+/** ***************************************************************** **/
+/**       COMPILE-TIME constant calls: ENABLE_PRINTF_CONST            **/
+/** ***************************************************************** **/
+#ifdef ENABLE_PRINTF_CONST
+
+// the output size of a call as a type, FmtConstNone when it isn't constant
+inline constexpr uint32_t FmtConstNone = 0xFFFFFFFF;
+
+template<uint32_t Value>
+struct FmtSizeConstant
+{
+    static constexpr uint32_t value = Value;
+};
+
+/** *****************************
+//  FmtConstWriter
+//  the fields of the fast path, formatted at compile-time one char at
+//  a time. Without 'out' only the size is counted
+****************************** **/
+struct FmtConstWriter
+{
+    char*    out  = nullptr;
+    uint32_t size = 0;
+
+    constexpr void put(char c)                  { if (out != nullptr) out[size] = c; size++; }
+    constexpr void put(char c, uint32_t count)  { while(count-- > 0) put(c); }
+};
+
+constexpr
+void
+writeFmtConstText(FmtConstWriter& writer, const char* text, uint32_t size, uint8_t flags, uint32_t width)
+{
+    uint32_t padding = width > size ? width - size : 0;
+
+    if ((flags & FmtFlagMinus) == 0) writer.put(' ', padding);
+
+    for(uint32_t i = 0; i < size; i++) writer.put(text[i]);
+
+    if ((flags & FmtFlagMinus) != 0) writer.put(' ', padding);
+}
+
+constexpr
+void
+writeFmtConstInteger(FmtConstWriter& writer, uint64_t magnitude, bool isNegative, char conversion, uint8_t flags, uint32_t width)
+{
+    const char* Digits = (conversion == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
+    uint32_t    Base   = (conversion == 'x' || conversion == 'X') ? 16 : 10;
+
+    char     digits[FmtFastIntegerSize] = {};
+    uint32_t begin = FmtFastIntegerSize;
+
+    do { digits[--begin] = Digits[magnitude % Base]; magnitude /= Base; } while(magnitude != 0);
+
+    uint32_t size    = FmtFastIntegerSize - begin + (isNegative ? 1 : 0);
+    uint32_t padding = width > size ? width - size : 0;
+
+    if ((flags & FmtFlagMinus) == 0 && (flags & FmtFlagZero) == 0) writer.put(' ', padding);
+
+    if (isNegative == true) writer.put('-');
+
+    if ((flags & FmtFlagMinus) == 0 && (flags & FmtFlagZero) != 0) writer.put('0', padding);
+
+    for(uint32_t i = begin; i < FmtFastIntegerSize; i++) writer.put(digits[i]);
+
+    if ((flags & FmtFlagMinus) != 0) writer.put(' ', padding);
+}
+
+template<typename Fmt, uint32_t Segment>
+constexpr
+void
+writeFmtConstSegment(FmtConstWriter& writer)
+{
+    constexpr auto& Layout = FmtFastLayoutOf<Fmt>;
+
+    for(uint32_t i = 0; i < Layout.segmentSize[Segment]; i++)
+        writer.put(Layout.text[Layout.segmentOffset[Segment] + i]);
+}
+
+template<typename Fmt, uint32_t I, typename T>
+constexpr
+void
+writeFmtConstField(FmtConstWriter& writer, T arg)
+{
+    constexpr FmtFieldDesc Field = FmtFastLayoutOf<Fmt>.table.fields[I];
+
+    writeFmtConstSegment<Fmt, I>(writer);
+
+    if constexpr (Field.conversion == 's')
+    {
+        const char* text = (arg != nullptr) ? (const char*)arg : "(null)";
+        uint32_t    size = 0;
+
+        while(text[size] != '\0') size++;
+
+        writeFmtConstText(writer, text, size, Field.flags, Field.width);
+    }
+    else if constexpr (Field.conversion == 'c')
+    {
+        char c = (char)(unsigned char)(int)arg;
+
+        writeFmtConstText(writer, &c, 1, Field.flags, Field.width);
+    }
+    else
+    {
+        bool     isNegative = false;
+        uint64_t magnitude  = getFmtFastMagnitude<Field.conversion, Field.length>(arg, isNegative);
+
+        writeFmtConstInteger(writer, magnitude, isNegative, Field.conversion, Field.flags, Field.width);
+    }
+}
+
+template<typename Fmt, std::size_t... I, typename... Args>
+constexpr
+void
+writeFmtConstFields(FmtConstWriter& writer, std::index_sequence<I...>, Args... args)
+{
+    (writeFmtConstField<Fmt, (uint32_t)I>(writer, args), ...);
+}
+
+/** *****************************
+//  formatFmtConst()
+//  the output of a call supported by the fast path, returns its size.
+//  It's a constant expression only when every argument is a constant,
+//  the strings too: FMT_CONST_CALL() checks it with __builtin_constant_p
+****************************** **/
+template<typename Fmt, typename... Args>
+constexpr
+uint32_t
+formatFmtConst(char* out, [[maybe_unused]] const char* fmt, [[maybe_unused]] Args... args)
+{
+    if constexpr (isFmtFastSupported<Fmt, Args...>() == true)
+    {
+        FmtConstWriter writer = { out, 0 };
+
+        writeFmtConstFields<Fmt>(writer, std::index_sequence_for<Args...>{}, args...);
+        writeFmtConstSegment<Fmt, FmtFastLayoutOf<Fmt>.table.size>(writer);
+
+        return writer.size;
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+// the types are from captureArgTypes(), the fmt first
+template<typename Fmt, typename FmtArg, typename... Args>
+CONSTEVAL
+bool
+isFmtConstSupported(FmtTypeList<FmtArg, Args...>)
+{
+    return isFmtFastSupported<Fmt, Args...>();
+}
+
+template<typename Fmt, uint32_t Size, typename... Args>
+constexpr
+std::array<char, Size + 1>
+makeFmtConstText(const char* fmt, Args... args)
+{
+    std::array<char, Size + 1> text = {};
+
+    formatFmtConst<Fmt>(text.data(), fmt, args...);
+
+    return text;
+}
+
+// the precomputed output without its '\0', the ones of "%c" included
+template<std::size_t TextSize>
+inline
+int
+writeFmtConst(FILE* file, const std::array<char, TextSize>& text)
+{
+    constexpr std::size_t Size = TextSize - 1;
+
+    if constexpr (Size == 0) return 0;
+    else                     return fwrite(text.data(), 1, Size, file) == Size ? (int)Size : -1;
+}
+
+#endif /** ENABLE_PRINTF_CONST **/
+
+/** ***************************************************************** **/
+/**       RUNTIME trace level: TRACEPRINT()                           **/
+/** ***************************************************************** **/
+template<bool Value>
+struct FmtBoolConstant
+{
+    static constexpr bool value = Value;
+};
+
+namespace printfcheck
+{
+
+#ifdef ENABLE_TRACE_SITES
+inline void updateTraceSites();
+#endif
+
+// the level xor INT32_MAX: zero is INT32_MAX, every level on. GCC 12
+// loses the initializers of the inline variables imported from a module.
+// As unsigned it decreases with the level
+inline uint32_t traceLevelXor = 0;
+
+[[gnu::always_inline]] inline
+void
+setTraceLevel(int level)
+{
+    __atomic_store_n(&traceLevelXor, (uint32_t)(level ^ INT32_MAX), __ATOMIC_RELAXED);
+
+#ifdef ENABLE_TRACE_SITES
+    updateTraceSites();
+#endif
+}
+
+[[gnu::always_inline]] inline
+int
+getTraceLevel()
+{
+    return (int)__atomic_load_n(&traceLevelXor, __ATOMIC_RELAXED) ^ INT32_MAX;
+}
+
+// a load and a branch in the caller: the constant levels are xor'ed at compile time
+[[gnu::always_inline]] inline
+bool
+isTraceLevelOn(int level)
+{
+    return (uint32_t)(level ^ INT32_MAX) >= __atomic_load_n(&traceLevelXor, __ATOMIC_RELAXED);
+}
+
+} // namespace printfcheck
+
+/** ***************************************************************** **/
+/**       RUNTIME trace sites: TRACEPRINT()                           **/
+/** ***************************************************************** **/
+//  with ENABLE_TRACE_SITES every TRACEPRINT() has a TraceSite: its file,
+// line, fmt and a state byte, the only thing read when it's off. The
+// state folds the level, the switch and the limits of the site, it's
+// updated when they change. A site is registered the first time it
+// runs, the rules set before are applied then
+#ifdef ENABLE_TRACE_SITES
+
+namespace printfcheck
+{
+
+enum class TraceSiteMode : uint8_t
+{
+    Default,            // on when its level is on
+    On,
+    Off,
+};
+
+// TraceSite::state
+inline constexpr uint8_t TraceSiteOff          = 0;
+inline constexpr uint8_t TraceSiteOn           = 1;
+inline constexpr uint8_t TraceSiteUnregistered = 2;
+inline constexpr uint8_t TraceSiteCheckLevel   = 3;    // the level isn't a constant
+inline constexpr uint8_t TraceSiteLimited      = 4;    // on, when its TraceSiteLimiter lets it
+
+/** *****************************
+//  TraceSiteLimiter
+//  1-in-N sampling and a token bucket: written by the threads of its
+//  site only, alone in its cache lines
+****************************** **/
+struct alignas(64) TraceSiteLimiter
+{
+    std::atomic<uint32_t> countdown  { 0 };     // calls to the next sampled one
+    std::atomic<int64_t>  tokens     { 0 };
+    std::atomic<int64_t>  refillTime { 0 };     // ns of the last refill
+    std::atomic<uint64_t> suppressed { 0 };
+    std::atomic<uint32_t> sampling   { 0 };     // 0 or 1: every call
+    std::atomic<uint32_t> rate       { 0 };     // traces per second, 0: no limit
+    std::atomic<uint32_t> burst      { 0 };
+    uint64_t              reported   = 0;       // 'suppressed' at the last report
+};
+
+struct TraceSite
+{
+    uint8_t       state        = TraceSiteUnregistered;
+    TraceSiteMode mode         = TraceSiteMode::Default;
+    bool          isConstLevel = false;
+    int32_t       level        = 0;
+    uint32_t      line         = 0;
+    const char*   file         = nullptr;
+    const char*   fmt          = nullptr;
+    uint64_t      id           = 0;
+    TraceSite*    next         = nullptr;
+
+    TraceSiteLimiter* limiter  = nullptr;       // set once, before the state TraceSiteLimited
+};
+
+// constant initialization: the static TraceSite of a call has no guard
+template<typename Fmt>
+constexpr
+TraceSite
+makeTraceSite()
+{
+    TraceSite site = {};
+
+    site.line = Fmt::line();
+    site.file = Fmt::file();
+    site.fmt  = Fmt::value();
+    site.id   = Fmt::id();
+
+    return site;
+}
+
+/** *****************************
+//  TraceSiteRule
+//  the sites of a selector:
+//      "path[:line]": the end of the file path, and the line
+//      "fmt:text":    the fmts with the text
+//      "*":           every site
+//  the last rule of each kind that matches a site wins
+****************************** **/
+enum class TraceSiteRuleKind : uint8_t
+{
+    Mode,
+    Sampling,
+    RateLimit,
+};
+
+struct TraceSiteRule
+{
+    std::string       file;
+    uint32_t          line     = 0;         // 0: every line
+    std::string       fmt;
+    TraceSiteRuleKind kind     = TraceSiteRuleKind::Mode;
+    TraceSiteMode     mode     = TraceSiteMode::Default;
+    uint32_t          sampling = 0;
+    uint32_t          rate     = 0;
+    uint32_t          burst    = 0;
+};
+
+struct TraceSiteRegistry
+{
+    std::mutex                                     mutex;       // owns everything but the states
+    TraceSite*                                     sites = nullptr;
+    std::vector<TraceSiteRule>                     rules;
+    std::vector<std::unique_ptr<TraceSiteLimiter>> limiters;    // never freed, the sites point to them
+    std::thread                                    watcher;
+    std::atomic<bool>                              isWatching  { false };
+    std::thread                                    reporter;
+    std::atomic<bool>                              isReporting { false };
+
+    ~TraceSiteRegistry();
+};
+
+inline TraceSiteRegistry traceSiteRegistry;
+
+// set by the signal of watchTraceSites()
+inline volatile std::sig_atomic_t traceSiteSignal = 0;
+
+// sets the selector of a rule
+inline
+bool
+parseTraceSiteSelector(std::string_view selector, TraceSiteRule& rule)
+{
+    if (selector.empty() == true) return false;
+    if (selector == "*")          return true;
+
+    if (selector.substr(0, 4) == "fmt:")
+    {
+        rule.fmt = selector.substr(4);
+        return true;
+    }
+
+    std::size_t colon = selector.rfind(':');
+    if (colon != std::string_view::npos && colon + 1 < selector.size() &&
+        selector.find_first_not_of("0123456789", colon + 1) == std::string_view::npos)
+    {
+        for(char c : selector.substr(colon + 1)) rule.line = rule.line * 10 + (uint32_t)(c - '0');
+        selector = selector.substr(0, colon);
+    }
+
+    rule.file = selector;
+    return true;
+}
+
+inline
+bool
+isTraceSiteRuleMatch(const TraceSiteRule& rule, const TraceSite& site)
+{
+    if (rule.line != 0 && rule.line != site.line) return false;
+
+    if (rule.fmt.empty() == false && std::string_view(site.fmt).find(rule.fmt) == std::string_view::npos)
+        return false;
+
+    if (rule.file.empty() == false)
+    {
+        std::string_view file = site.file;
+
+        // the end of the path, at a '/'
+        if (file.size() < rule.file.size() || file.substr(file.size() - rule.file.size()) != rule.file)
+            return false;
+        if (file.size() > rule.file.size() && rule.file.front() != '/' && file[file.size() - rule.file.size() - 1] != '/')
+            return false;
+    }
+
+    return true;
+}
+
+// CLOCK_MONOTONIC_COARSE: no syscall, at the resolution of the tick
+inline
+int64_t
+getTraceCoarseTime()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// with the registry locked
+inline
+void
+updateTraceSite(TraceSite& site)
+{
+    uint32_t sampling = 0;
+    uint32_t rate     = 0;
+    uint32_t burst    = 0;
+
+    site.mode = TraceSiteMode::Default;
+
+    for(const TraceSiteRule& rule : traceSiteRegistry.rules)
+    {
+        if (isTraceSiteRuleMatch(rule, site) == false) continue;
+
+        if      (rule.kind == TraceSiteRuleKind::Mode)     site.mode = rule.mode;
+        else if (rule.kind == TraceSiteRuleKind::Sampling) sampling  = rule.sampling;
+        else                                               { rate = rule.rate; burst = rule.burst; }
+    }
+
+    uint8_t state = TraceSiteCheckLevel;
+
+    if      (site.mode == TraceSiteMode::On)  state = TraceSiteOn;
+    else if (site.mode == TraceSiteMode::Off) state = TraceSiteOff;
+    else if (site.isConstLevel == true)       state = isTraceLevelOn(site.level) == true ? TraceSiteOn : TraceSiteOff;
+
+    bool isLimited = sampling > 1 || rate != 0;
+
+    if (isLimited == true && site.limiter == nullptr)
+    {
+        traceSiteRegistry.limiters.push_back(std::make_unique<TraceSiteLimiter>());
+        __atomic_store_n(&site.limiter, traceSiteRegistry.limiters.back().get(), __ATOMIC_RELEASE);
+    }
+
+    if (site.limiter != nullptr)
+    {
+        TraceSiteLimiter& limiter = *site.limiter;
+
+        // a new bucket starts full
+        if (limiter.rate.load(std::memory_order_relaxed) != rate || limiter.burst.load(std::memory_order_relaxed) != burst)
+        {
+            limiter.tokens.store(burst, std::memory_order_relaxed);
+            limiter.refillTime.store(getTraceCoarseTime(), std::memory_order_relaxed);
+        }
+
+        limiter.sampling.store(sampling, std::memory_order_relaxed);
+        limiter.rate.store(rate, std::memory_order_relaxed);
+        limiter.burst.store(burst, std::memory_order_relaxed);
+    }
+
+    if (state == TraceSiteOn && isLimited == true) state = TraceSiteLimited;
+
+    __atomic_store_n(&site.state, state, __ATOMIC_RELAXED);
+}
+
+inline
+void
+updateTraceSites()
+{
+    std::lock_guard<std::mutex> lock(traceSiteRegistry.mutex);
+
+    for(TraceSite* site = traceSiteRegistry.sites; site != nullptr; site = site->next)
+        updateTraceSite(*site);
+}
+
+/** *****************************
+//  passTraceSiteLimiter()
+//  a suppressed call is relaxed loads and stores, no locked
+//  instruction: the threads of a site that race can lose a count. A
+//  token is taken with a decrement. The empty bucket checks the clock
+//  every 8 calls, the tokens of the time elapsed aren't lost
+****************************** **/
+[[gnu::noinline]] inline
+bool
+refillTraceSiteLimiter(TraceSiteLimiter& limiter)
+{
+    int64_t now     = getTraceCoarseTime();
+    int64_t last    = limiter.refillTime.load(std::memory_order_relaxed);
+    int64_t rate    = limiter.rate.load(std::memory_order_relaxed);
+    int64_t burst   = std::max<int64_t>(limiter.burst.load(std::memory_order_relaxed), 1);
+    int64_t elapsed = now - last;
+
+    if (rate == 0) return true;
+
+    int64_t added = elapsed >= 1000000000 ? burst : elapsed * rate / 1000000000;
+    if (added <= 0) return false;
+
+    // the time of the tokens added, the rest counts for the next refill
+    int64_t refilled = elapsed >= 1000000000 ? now : last + added * 1000000000 / rate;
+
+    // another thread refilled it meanwhile
+    if (limiter.refillTime.compare_exchange_strong(last, refilled, std::memory_order_relaxed) == false)
+        return limiter.tokens.fetch_sub(1, std::memory_order_relaxed) > 0;
+
+    // this call takes one of the tokens added
+    int64_t tokens = limiter.tokens.load(std::memory_order_relaxed);
+    while(limiter.tokens.compare_exchange_weak(tokens, std::min(burst, std::max<int64_t>(tokens, 0) + added) - 1,
+                                               std::memory_order_relaxed) == false)
+    {
+    }
+
+    return true;
+}
+
+[[gnu::always_inline]] inline
+bool
+passTraceSiteLimiter(TraceSiteLimiter& limiter)
+{
+    uint64_t suppressed = limiter.suppressed.load(std::memory_order_relaxed);
+    uint32_t sampling   = limiter.sampling.load(std::memory_order_relaxed);
+    bool     isPassed   = true;
+
+    if (sampling > 1)
+    {
+        uint32_t countdown = limiter.countdown.load(std::memory_order_relaxed);
+
+        limiter.countdown.store(countdown > 1 ? countdown - 1 : sampling, std::memory_order_relaxed);
+        isPassed = countdown <= 1;
+    }
+
+    if (isPassed == true && limiter.rate.load(std::memory_order_relaxed) != 0)
+    {
+        isPassed = (limiter.tokens.load(std::memory_order_relaxed) > 0 &&
+                    limiter.tokens.fetch_sub(1, std::memory_order_relaxed) > 0) ||
+                   ((suppressed & 7) == 0 && refillTraceSiteLimiter(limiter) == true);
+    }
+
+    if (isPassed == false) limiter.suppressed.store(suppressed + 1, std::memory_order_relaxed);
+
+    return isPassed;
+}
+
+// first call of the site, or its level isn't a constant
+[[gnu::noinline]] inline
+bool
+isTraceSiteOnSlow(TraceSite& site, int level, bool isConstLevel)
+{
+    if (__atomic_load_n(&site.state, __ATOMIC_ACQUIRE) == TraceSiteUnregistered)
+    {
+        std::lock_guard<std::mutex> lock(traceSiteRegistry.mutex);
+
+        if (site.state == TraceSiteUnregistered)
+        {
+            site.level        = level;
+            site.isConstLevel = isConstLevel;
+            site.next         = traceSiteRegistry.sites;
+            traceSiteRegistry.sites = &site;
+
+            updateTraceSite(site);
+        }
+    }
+
+    uint8_t state = __atomic_load_n(&site.state, __ATOMIC_RELAXED);
+
+    if (state == TraceSiteOff || state == TraceSiteOn)                   return state == TraceSiteOn;
+    if (state == TraceSiteCheckLevel && isTraceLevelOn(level) == false) return false;
+
+    TraceSiteLimiter* limiter = __atomic_load_n(&site.limiter, __ATOMIC_ACQUIRE);
+    return limiter == nullptr || passTraceSiteLimiter(*limiter) == true;
+}
+
+// off: a byte load and a branch in the caller
+[[gnu::always_inline]] inline
+bool
+isTraceSiteOn(TraceSite& site, int level, bool isConstLevel)
+{
+    uint8_t state = __atomic_load_n(&site.state, __ATOMIC_RELAXED);
+
+    if (state == TraceSiteOff) return false;
+    if (state == TraceSiteOn)  return true;
+
+    // a limiter is set once, before the state that uses it: the site is on until it's seen
+    if (state == TraceSiteLimited)
+    {
+        TraceSiteLimiter* limiter = __atomic_load_n(&site.limiter, __ATOMIC_ACQUIRE);
+        return limiter == nullptr || passTraceSiteLimiter(*limiter) == true;
+    }
+
+    return isTraceSiteOnSlow(site, level, isConstLevel);
+}
+
+/** *****************************
+//  setTraceSite(), setTraceSiteSampling(), setTraceSiteRateLimit(),
+//  clearTraceSites()
+//  a rule for the sites already registered and the next ones
+****************************** **/
+inline
+bool
+addTraceSiteRule(std::string_view selector, TraceSiteRule rule)
+{
+    if (parseTraceSiteSelector(selector, rule) == false) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(traceSiteRegistry.mutex);
+        traceSiteRegistry.rules.push_back(std::move(rule));
+    }
+
+    updateTraceSites();
+    return true;
+}
+
+inline
+bool
+setTraceSite(std::string_view selector, TraceSiteMode mode)
+{
+    TraceSiteRule rule;
+    rule.kind = TraceSiteRuleKind::Mode;
+    rule.mode = mode;
+
+    return addTraceSiteRule(selector, std::move(rule));
+}
+
+// a trace every 'sampling' calls, 0 or 1: every call
+inline
+bool
+setTraceSiteSampling(std::string_view selector, uint32_t sampling)
+{
+    TraceSiteRule rule;
+    rule.kind     = TraceSiteRuleKind::Sampling;
+    rule.sampling = sampling;
+
+    return addTraceSiteRule(selector, std::move(rule));
+}
+
+// 'rate' traces per second, 'burst' at once (0: 'rate'). 'rate' 0: no limit
+inline
+bool
+setTraceSiteRateLimit(std::string_view selector, uint32_t rate, uint32_t burst = 0)
+{
+    TraceSiteRule rule;
+    rule.kind  = TraceSiteRuleKind::RateLimit;
+    rule.rate  = rate;
+    rule.burst = burst != 0 ? burst : rate;
+
+    return addTraceSiteRule(selector, std::move(rule));
+}
+
+inline
+void
+clearTraceSites()
+{
+    {
+        std::lock_guard<std::mutex> lock(traceSiteRegistry.mutex);
+        traceSiteRegistry.rules.clear();
+    }
+
+    updateTraceSites();
+}
+
+/** *****************************
+//  loadTraceSites()
+//  the rules of a file replace the current ones, a rule per line:
+//      on      net/socket.cpp:120
+//      off     fmt:heartbeat
+//      default *
+//      sample  100 fmt:retry           a trace every 100 calls
+//      limit   50 net/socket.cpp       50 traces per second
+//      limit   50:200 net/             50 per second, 200 at once
+//  '#' starts a comment
+****************************** **/
+inline
+std::string_view
+popTraceSiteWord(std::string_view& text)
+{
+    std::size_t begin = std::min(text.size(), text.find_first_not_of(" \t"));
+    std::size_t end   = std::min(text.size(), text.find_first_of(" \t", begin));
+
+    std::string_view word = text.substr(begin, end - begin);
+    text = text.substr(end);
+    return word;
+}
+
+inline
+bool
+parseTraceSiteNumber(std::string_view text, uint32_t& number)
+{
+    number = 0;
+    if (text.empty() == true || text.size() > 9 || text.find_first_not_of("0123456789") != std::string_view::npos)
+        return false;
+
+    for(char c : text) number = number * 10 + (uint32_t)(c - '0');
+    return true;
+}
+
+inline
+bool
+loadTraceSites(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) return false;
+
+    std::vector<TraceSiteRule> rules;
+    bool                       isValid = true;
+    char                       line[1024];
+
+    while(fgets(line, sizeof(line), file) != nullptr)
+    {
+        std::string_view text = line;
+
+        text = text.substr(0, text.find('#'));
+
+        std::size_t begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string_view::npos) continue;
+        text = text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+
+        std::string_view command = popTraceSiteWord(text);
+        TraceSiteRule    rule;
+
+        if      (command == "on")       rule.mode = TraceSiteMode::On;
+        else if (command == "off")      rule.mode = TraceSiteMode::Off;
+        else if (command == "default")  rule.mode = TraceSiteMode::Default;
+        else if (command == "sample")
+        {
+            rule.kind = TraceSiteRuleKind::Sampling;
+            isValid  &= parseTraceSiteNumber(popTraceSiteWord(text), rule.sampling);
+        }
+        else if (command == "limit")
+        {
+            std::string_view limit = popTraceSiteWord(text);
+            std::size_t      colon = limit.find(':');
+
+            rule.kind  = TraceSiteRuleKind::RateLimit;
+            isValid   &= parseTraceSiteNumber(limit.substr(0, colon), rule.rate);
+            rule.burst = rule.rate;
+            if (colon != std::string_view::npos) isValid &= parseTraceSiteNumber(limit.substr(colon + 1), rule.burst);
+        }
+        else
+        {
+            isValid = false;
+        }
+
+        text = text.substr(std::min(text.size(), text.find_first_not_of(" \t")));
+
+        if (isValid == true && parseTraceSiteSelector(text, rule) == true) rules.push_back(std::move(rule));
+        else                                                               isValid = false;
+    }
+
+    fclose(file);
+
+    // a file with an error changes nothing
+    if (isValid == false) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(traceSiteRegistry.mutex);
+        traceSiteRegistry.rules = std::move(rules);
+    }
+
+    updateTraceSites();
+    return true;
+}
+
+/** *****************************
+//  watchTraceSites(), stopWatchingTraceSites()
+//  loads the file, and again when it's modified or the process gets
+//  'signal' (0: none). A thread checks both every 'period'
+****************************** **/
+inline
+void
+stopWatchingTraceSites()
+{
+    if (traceSiteRegistry.isWatching.exchange(false) == true)
+        traceSiteRegistry.watcher.join();
+}
+
+inline
+bool
+watchTraceSites(const char* path, int signal = SIGHUP, std::chrono::milliseconds period = std::chrono::milliseconds(500))
+{
+    stopWatchingTraceSites();
+
+    bool isLoaded = loadTraceSites(path);
+
+    if (signal != 0) std::signal(signal, [](int) { traceSiteSignal = 1; });
+
+    traceSiteRegistry.isWatching.store(true);
+    traceSiteRegistry.watcher = std::thread([file = std::string(path), period]()
+    {
+        struct stat status   = {};
+        auto        modified = stat(file.c_str(), &status) == 0 ? status.st_mtim : timespec{};
+
+        while(traceSiteRegistry.isWatching.load(std::memory_order_relaxed) == true)
+        {
+            std::this_thread::sleep_for(period);
+
+            bool isModified = stat(file.c_str(), &status) == 0 &&
+                              (status.st_mtim.tv_sec != modified.tv_sec || status.st_mtim.tv_nsec != modified.tv_nsec);
+
+            if (isModified == true || traceSiteSignal != 0)
+            {
+                traceSiteSignal = 0;
+                modified        = status.st_mtim;
+                loadTraceSites(file.c_str());
+            }
+        }
+    });
+
+    return isLoaded;
+}
+
+/** *****************************
+//  reportTraceSites(), startTraceSiteReporter(), stopTraceSiteReporter()
+//  the traces suppressed by the limits since the last report, per
+//  site. The reporter thread reports every 'period'
+****************************** **/
+inline
+void
+reportTraceSites(FILE* file = stderr)
+{
+    std::lock_guard<std::mutex> lock(traceSiteRegistry.mutex);
+
+    for(TraceSite* site = traceSiteRegistry.sites; site != nullptr; site = site->next)
+    {
+        if (site->limiter == nullptr) continue;
+
+        uint64_t suppressed = site->limiter->suppressed.load(std::memory_order_relaxed);
+        if (suppressed == site->limiter->reported) continue;
+
+        (fprintf)(file, "printfcheck: %llu traces suppressed at %s:%u \"%.*s\"\n",
+                (unsigned long long)(suppressed - site->limiter->reported), site->file, site->line,
+                (int)strcspn(site->fmt, "\n"), site->fmt);
+
+        site->limiter->reported = suppressed;
+    }
+
+    fflush(file);
+}
+
+inline
+void
+stopTraceSiteReporter()
+{
+    if (traceSiteRegistry.isReporting.exchange(false) == true)
+        traceSiteRegistry.reporter.join();
+}
+
+inline
+void
+startTraceSiteReporter(FILE* file = stderr, std::chrono::milliseconds period = std::chrono::seconds(10))
+{
+    stopTraceSiteReporter();
+
+    traceSiteRegistry.isReporting.store(true);
+    traceSiteRegistry.reporter = std::thread([file, period]()
+    {
+        auto step = std::min(period, std::chrono::milliseconds(100));
+        auto next = std::chrono::steady_clock::now() + period;
+
+        // short sleeps: stopping doesn't wait for the period
+        while(traceSiteRegistry.isReporting.load(std::memory_order_relaxed) == true)
+        {
+            std::this_thread::sleep_for(step);
+
+            if (std::chrono::steady_clock::now() >= next)
+            {
+                next += period;
+                reportTraceSites(file);
+            }
+        }
+    });
+}
+
+inline
+TraceSiteRegistry::~TraceSiteRegistry()
+{
+    stopWatchingTraceSites();
+    stopTraceSiteReporter();
+}
+
+/** *****************************
+//  dumpTraceSites()
+//  the registered sites and their state
+****************************** **/
+inline
+void
+dumpTraceSites(FILE* file = stdout)
+{
+    std::lock_guard<std::mutex> lock(traceSiteRegistry.mutex);
+
+    for(const TraceSite* site = traceSiteRegistry.sites; site != nullptr; site = site->next)
+    {
+        uint8_t     state = __atomic_load_n(&site->state, __ATOMIC_RELAXED);
+        const char* text  = state == TraceSiteOn      ? "on"      :
+                            state == TraceSiteOff     ? "off"     :
+                            state == TraceSiteLimited ? "limited" : "level";
+
+        (fprintf)(file, "%-7s %s:%u level %d \"%.*s\"", text, site->file, site->line, site->level,
+                (int)strcspn(site->fmt, "\n"), site->fmt);
+
+        if (site->limiter != nullptr)
+            (fprintf)(file, " sample %u limit %u:%u suppressed %llu",
+                    site->limiter->sampling.load(std::memory_order_relaxed), site->limiter->rate.load(std::memory_order_relaxed),
+                    site->limiter->burst.load(std::memory_order_relaxed),
+                    (unsigned long long)site->limiter->suppressed.load(std::memory_order_relaxed));
+
+        (fprintf)(file, "\n");
+    }
+}
+
+} // namespace printfcheck
+
+#endif /** ENABLE_TRACE_SITES **/
+
+/** ***************************************************************** **/
+/**       RUNTIME call site profile: printf()                         **/
+/** ***************************************************************** **/
+//  with ENABLE_PRINTF_PROFILE every wrapped printf() and TRACEPRINT()
+// counts its calls and the bytes it printed. A site gets an index the
+// first time it runs, every thread counts in its own table of counters
+#ifdef ENABLE_PRINTF_PROFILE
+
+#ifndef PRINTF_PROFILE_SITES
+#define PRINTF_PROFILE_SITES                (1 << 18)       // the sites after are counted in the last one
+#endif
+
+namespace printfcheck
+{
+
+struct PrintfLatency;
+
+struct PrintfSite
+{
+    uint32_t       index   = 0;             // 0: not registered yet
+    int32_t        level   = -1;            // -1: not a trace
+    uint32_t       line    = 0;
+    const char*    file    = nullptr;
+    const char*    fmt     = nullptr;
+    PrintfLatency* latency = nullptr;       // with ENABLE_PRINTF_LATENCY, set once when registered
+};
+
+// constant initialization: the static PrintfSite of a call has no guard
+template<typename Fmt>
+constexpr
+PrintfSite
+makePrintfSite()
+{
+    PrintfSite site = {};
+
+    site.line = Fmt::line();
+    site.file = Fmt::file();
+    site.fmt  = Fmt::value();
+
+    return site;
+}
+
+// written by its thread only: relaxed loads and stores, no locked instruction
+struct PrintfCounter
+{
+    std::atomic<uint64_t> calls { 0 };
+    std::atomic<uint64_t> bytes { 0 };
+};
+
+inline constexpr uint32_t PrintfCounterChunkSize = 256;
+inline constexpr uint32_t PrintfCounterChunks    = (PRINTF_PROFILE_SITES + PrintfCounterChunkSize - 1) / PrintfCounterChunkSize;
+
+struct alignas(64) PrintfCounterChunk
+{
+    PrintfCounter counters[PrintfCounterChunkSize];
+};
+
+/** *****************************
+//  PrintfCounterTable
+//  the counters of a thread, by site index. The chunks are allocated
+//  when the thread first calls one of their sites: the cache lines of
+//  a thread aren't shared with the others
+****************************** **/
+struct PrintfCounterTable
+{
+    std::atomic<PrintfCounterChunk*> chunks[PrintfCounterChunks] = {};
+    std::atomic<bool>                isClosed { false };    // its thread has exited
+
+    ~PrintfCounterTable()
+    {
+        for(auto& chunk : chunks) delete chunk.load(std::memory_order_relaxed);
+    }
+};
+
+/** *****************************
+//  PrintfProfileRegistry
+//  the sites by index, and the tables of every thread. A table is
+//  freed by the next report once its thread has exited, its counts are
+//  kept in 'retired'
+****************************** **/
+struct PrintfProfileRegistry
+{
+    std::mutex                                       mutex;
+    std::vector<const PrintfSite*>                   sites = { nullptr };   // index 0 isn't a site
+    std::vector<std::unique_ptr<PrintfCounterTable>> tables;
+    std::vector<std::pair<uint64_t, uint64_t>>       retired;               // calls and bytes, by index
+#ifdef ENABLE_PRINTF_LATENCY
+    std::vector<std::unique_ptr<PrintfLatency>>      latencies;             // never freed, the sites point to them
+#endif
+};
+
+inline PrintfProfileRegistry printfProfileRegistry;
+
+struct PrintfCounterOwner
+{
+    PrintfCounterTable* table = nullptr;
+
+    ~PrintfCounterOwner()
+    {
+        if (table != nullptr) table->isClosed.store(true, std::memory_order_release);
+    }
+};
+
+inline thread_local PrintfCounterOwner printfCounterOwner;
+
+// first call of the site, or of the thread in its chunk
+[[gnu::noinline]] inline
+PrintfCounter&
+getPrintfCounterSlow(PrintfSite& site, int level)
+{
+    uint32_t index = __atomic_load_n(&site.index, __ATOMIC_ACQUIRE);
+
+    if (index == 0 || printfCounterOwner.table == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(printfProfileRegistry.mutex);
+
+        if (site.index == 0)
+        {
+            site.level = level;
+            index      = (uint32_t)std::min<size_t>(printfProfileRegistry.sites.size(), PrintfCounterChunks * PrintfCounterChunkSize - 1);
+
+            if (index == printfProfileRegistry.sites.size())
+            {
+                printfProfileRegistry.sites.push_back(&site);
+#ifdef ENABLE_PRINTF_LATENCY
+                printfProfileRegistry.latencies.push_back(std::make_unique<PrintfLatency>());
+                __atomic_store_n(&site.latency, printfProfileRegistry.latencies.back().get(), __ATOMIC_RELEASE);
+#endif
+            }
+
+            __atomic_store_n(&site.index, index, __ATOMIC_RELEASE);
+        }
+
+        index = site.index;
+
+        if (printfCounterOwner.table == nullptr)
+        {
+            printfProfileRegistry.tables.push_back(std::make_unique<PrintfCounterTable>());
+            printfCounterOwner.table = printfProfileRegistry.tables.back().get();
+        }
+    }
+
+    std::atomic<PrintfCounterChunk*>& chunk = printfCounterOwner.table->chunks[index / PrintfCounterChunkSize];
+
+    if (chunk.load(std::memory_order_relaxed) == nullptr) chunk.store(new PrintfCounterChunk(), std::memory_order_release);
+
+    return chunk.load(std::memory_order_relaxed)->counters[index % PrintfCounterChunkSize];
+}
+
+// returns 'bytes', what the printf() of the site returned
+[[gnu::always_inline]] inline
+int
+countPrintf(PrintfSite& site, int level, int bytes)
+{
+    uint32_t            index = __atomic_load_n(&site.index, __ATOMIC_RELAXED);
+    PrintfCounterTable* table = printfCounterOwner.table;
+    PrintfCounterChunk* chunk = table != nullptr ? table->chunks[index / PrintfCounterChunkSize].load(std::memory_order_relaxed) : nullptr;
+
+    PrintfCounter& counter = (index != 0 && chunk != nullptr) ? chunk->counters[index % PrintfCounterChunkSize]
+                                                              : getPrintfCounterSlow(site, level);
+
+    counter.calls.store(counter.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (bytes > 0) counter.bytes.store(counter.bytes.load(std::memory_order_relaxed) + (uint64_t)bytes, std::memory_order_relaxed);
+
+    return bytes;
+}
+
+/** *****************************
+//  getPrintfProfile(), dumpPrintfProfile()
+//  the sites that ran, by bytes printed then by calls: the 'count'
+//  first (0: all)
+****************************** **/
+struct PrintfProfileEntry
+{
+    const PrintfSite* site  = nullptr;
+    uint64_t          calls = 0;
+    uint64_t          bytes = 0;
+};
+
+inline
+std::vector<PrintfProfileEntry>
+getPrintfProfile(size_t count = 0)
+{
+    std::vector<PrintfProfileEntry> entries;
+
+    {
+        std::lock_guard<std::mutex> lock(printfProfileRegistry.mutex);
+
+        auto& registry = printfProfileRegistry;
+        registry.retired.resize(registry.sites.size());
+
+        entries.resize(registry.sites.size());
+        for(size_t i = 0; i < entries.size(); i++)
+        {
+            entries[i].site  = registry.sites[i];
+            entries[i].calls = registry.retired[i].first;
+            entries[i].bytes = registry.retired[i].second;
+        }
+
+        for(auto table = registry.tables.begin(); table != registry.tables.end(); )
+        {
+            bool isClosed = (*table)->isClosed.load(std::memory_order_acquire);
+
+            for(uint32_t c = 0; c < PrintfCounterChunks; c++)
+            {
+                PrintfCounterChunk* chunk = (*table)->chunks[c].load(std::memory_order_acquire);
+                if (chunk == nullptr) continue;
+
+                for(uint32_t i = 0; i < PrintfCounterChunkSize && c * PrintfCounterChunkSize + i < entries.size(); i++)
+                {
+                    uint64_t calls = chunk->counters[i].calls.load(std::memory_order_relaxed);
+                    uint64_t bytes = chunk->counters[i].bytes.load(std::memory_order_relaxed);
+
+                    entries[c * PrintfCounterChunkSize + i].calls += calls;
+                    entries[c * PrintfCounterChunkSize + i].bytes += bytes;
+
+                    if (isClosed == true)
+                    {
+                        registry.retired[c * PrintfCounterChunkSize + i].first  += calls;
+                        registry.retired[c * PrintfCounterChunkSize + i].second += bytes;
+                    }
+                }
+            }
+
+            table = isClosed == true ? registry.tables.erase(table) : table + 1;
+        }
+    }
+
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [](const PrintfProfileEntry& entry) { return entry.site == nullptr || entry.calls == 0; }),
+                  entries.end());
+
+    std::sort(entries.begin(), entries.end(), [](const PrintfProfileEntry& a, const PrintfProfileEntry& b)
+    {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.calls > b.calls;
+    });
+
+    if (count != 0 && entries.size() > count) entries.resize(count);
+
+    return entries;
+}
+
+inline
+void
+dumpPrintfProfile(FILE* file = stdout, size_t count = 20)
+{
+    (fprintf)(file, "%12s %14s %5s  %s\n", "calls", "bytes", "level", "site");
+
+    for(const PrintfProfileEntry& entry : getPrintfProfile(count))
+    {
+        const PrintfSite& site = *entry.site;
+
+        (fprintf)(file, "%12llu %14llu %5d  %s:%u \"%.*s\"\n", (unsigned long long)entry.calls,
+                (unsigned long long)entry.bytes, site.level, site.file, site.line,
+                (int)strcspn(site.fmt, "\n"), site.fmt);
+    }
+}
+
+#ifdef ENABLE_PRINTF_LATENCY
+/** *****************************
+//  PrintfLatency
+//  log-linear histogram of the call times of a site, like HDR: 16
+//  buckets per power of 2, ~6% of error. The times are cycles of
+//  getPrintfTicks(), converted to ns when exported. The site's
+//  threads share it: a relaxed increment, the call locks its FILE anyway
+****************************** **/
+inline constexpr uint32_t PrintfLatencySubBits = 4;
+inline constexpr uint32_t PrintfLatencyMaxBits = 40;    // longer calls are counted in the last bucket
+inline constexpr uint32_t PrintfLatencyBuckets = (PrintfLatencyMaxBits - PrintfLatencySubBits + 1) << PrintfLatencySubBits;
+
+struct alignas(64) PrintfLatency
+{
+    std::atomic<uint64_t> buckets[PrintfLatencyBuckets] = {};
+};
+
+// a cycle counter, not serializing: the call it measures is much longer
+[[gnu::always_inline]] inline
+uint64_t
+getPrintfTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+constexpr
+uint32_t
+getPrintfLatencyBucket(uint64_t ticks)
+{
+    ticks = std::min<uint64_t>(ticks, ((uint64_t)1 << PrintfLatencyMaxBits) - 1);
+    if (ticks < (1u << PrintfLatencySubBits)) return (uint32_t)ticks;
+
+    uint32_t exponent = 63 - (uint32_t)__builtin_clzll(ticks);
+
+    return ((exponent - PrintfLatencySubBits + 1) << PrintfLatencySubBits) +
+           (uint32_t)(ticks >> (exponent - PrintfLatencySubBits)) - (1u << PrintfLatencySubBits);
+}
+
+// the middle of the bucket
+constexpr
+double
+getPrintfLatencyTicks(uint32_t bucket)
+{
+    if (bucket < (1u << PrintfLatencySubBits)) return bucket;
+
+    uint32_t exponent = (bucket >> PrintfLatencySubBits) + PrintfLatencySubBits - 1;
+    uint64_t first    = (uint64_t)((bucket & ((1u << PrintfLatencySubBits) - 1)) + (1u << PrintfLatencySubBits))
+                        << (exponent - PrintfLatencySubBits);
+
+    return (double)first + (double)((uint64_t)1 << (exponent - PrintfLatencySubBits)) / 2;
+}
+
+static_assert(getPrintfLatencyBucket(((uint64_t)1 << PrintfLatencyMaxBits) - 1) == PrintfLatencyBuckets - 1, "the last bucket");
+static_assert(getPrintfLatencyBucket(1000) == getPrintfLatencyBucket((uint64_t)getPrintfLatencyTicks(getPrintfLatencyBucket(1000))),
+              "a bucket contains its middle");
+
+// after countPrintf(): the site is registered
+[[gnu::always_inline]] inline
+void
+countPrintfLatency(PrintfSite& site, uint64_t ticks)
+{
+    PrintfLatency* latency = __atomic_load_n(&site.latency, __ATOMIC_ACQUIRE);
+
+    if (latency != nullptr)
+        latency->buckets[getPrintfLatencyBucket(ticks)].fetch_add(1, std::memory_order_relaxed);
+}
+
+// ns per tick, measured once over 20ms
+inline
+double
+getPrintfTickNs()
+{
+    static const double tickNs = []()
+    {
+        auto     start      = std::chrono::steady_clock::now();
+        uint64_t startTicks = getPrintfTicks();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return ns / (double)std::max<uint64_t>(getPrintfTicks() - startTicks, 1);
+    }();
+
+    return tickNs;
+}
+
+/** *****************************
+//  getPrintfLatencies(), dumpPrintfLatencies()
+//  the percentiles of every site that ran, in ns, by p999 then by p99:
+//  the 'count' first (0: all)
+****************************** **/
+struct PrintfLatencyEntry
+{
+    const PrintfSite* site  = nullptr;
+    uint64_t          calls = 0;
+    double            p50   = 0;
+    double            p99   = 0;
+    double            p999  = 0;
+    double            max   = 0;
+};
+
+inline
+std::vector<PrintfLatencyEntry>
+getPrintfLatencies(size_t count = 0)
+{
+    std::vector<PrintfLatencyEntry> entries;
+    double                          tickNs = getPrintfTickNs();
+
+    std::lock_guard<std::mutex> lock(printfProfileRegistry.mutex);
+
+    for(const PrintfSite* site : printfProfileRegistry.sites)
+    {
+        if (site == nullptr || site->latency == nullptr) continue;
+
+        uint64_t buckets[PrintfLatencyBuckets];
+        uint64_t calls = 0;
+
+        for(uint32_t i = 0; i < PrintfLatencyBuckets; i++)
+        {
+            buckets[i] = site->latency->buckets[i].load(std::memory_order_relaxed);
+            calls     += buckets[i];
+        }
+
+        if (calls == 0) continue;
+
+        PrintfLatencyEntry entry;
+        entry.site  = site;
+        entry.calls = calls;
+
+        // the bucket of the call at each rank
+        double*  percentiles[] = { &entry.p50, &entry.p99, &entry.p999 };
+        uint64_t ranks[]       = { (calls * 500 + 999) / 1000, (calls * 990 + 999) / 1000, (calls * 999 + 999) / 1000 };
+        uint64_t below         = 0;
+        size_t   next          = 0;
+
+        for(uint32_t i = 0; i < PrintfLatencyBuckets; i++)
+        {
+            if (buckets[i] == 0) continue;
+
+            below += buckets[i];
+            for(; next < 3 && below >= ranks[next]; next++) *percentiles[next] = getPrintfLatencyTicks(i) * tickNs;
+            entry.max = getPrintfLatencyTicks(i) * tickNs;
+        }
+
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const PrintfLatencyEntry& a, const PrintfLatencyEntry& b)
+    {
+        return a.p999 != b.p999 ? a.p999 > b.p999 : a.p99 > b.p99;
+    });
+
+    if (count != 0 && entries.size() > count) entries.resize(count);
+
+    return entries;
+}
+
+inline
+void
+dumpPrintfLatencies(FILE* file = stdout, size_t count = 20)
+{
+    (fprintf)(file, "%12s %10s %10s %10s %10s  %s\n", "calls", "p50[ns]", "p99[ns]", "p999[ns]", "max[ns]", "site");
+
+    for(const PrintfLatencyEntry& entry : getPrintfLatencies(count))
+    {
+        const PrintfSite& site = *entry.site;
+
+        (fprintf)(file, "%12llu %10.0f %10.0f %10.0f %10.0f  %s:%u \"%.*s\"\n", (unsigned long long)entry.calls,
+                entry.p50, entry.p99, entry.p999, entry.max, site.file, site.line,
+                (int)strcspn(site.fmt, "\n"), site.fmt);
+    }
+}
+#endif /** ENABLE_PRINTF_LATENCY **/
+
+} // namespace printfcheck
+
+#endif /** ENABLE_PRINTF_PROFILE **/
+
+/** ***************************************************************** **/
+/**       RUNTIME deferred traces: TRACEPRINT()                       **/
+/** ***************************************************************** **/
+//  with ENABLE_TRACE_DEFERRED the caller only copies a format ID and the
+// arguments into a ring of its thread, a consumer thread prints them later
+#ifdef ENABLE_TRACE_DEFERRED
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE                     (1 << 18)       // bytes per thread
+#endif
+
+namespace printfcheck
+{
+
+static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0 && TRACE_RING_SIZE >= 4096,
+              "TRACE_RING_SIZE must be a power of 2");
+
+// the format ID: the fmt and the function that prints its records
+using TraceDecodeFunc = int (*)(FILE* file, const char* args);
+
+struct TraceSectionHeader;
+
+struct TraceFormat
+{
+    const char*               fmt    = nullptr;
+    TraceDecodeFunc           decode = nullptr;
+    uint64_t                  id     = 0;           // stable, written in the binary traces
+    const TraceSectionHeader* entry  = nullptr;     // in the "printfcheck_fmts" section
+};
+
+// a record is the header + the packed arguments, 8 bytes aligned
+struct TraceRecordHeader
+{
+    uint32_t           size     = 0;        // 0: skip to the start of the ring
+    uint32_t           reserved = 0;
+    const TraceFormat* format   = nullptr;
+};
+
+inline constexpr uint32_t TraceRecordAlign  = 8;
+inline constexpr uint32_t TraceStringNull   = UINT32_MAX;
+
+/** *****************************
+//  TraceOverflow
+//  what TRACEPRINT() does when the ring of its thread is full, set
+//  per level with setTraceOverflow()
+****************************** **/
+enum class TraceOverflow : uint8_t
+{
+    Block,              // waits for the consumer, or flushes when there isn't one
+    Drop,               // the new record is dropped and counted
+    Overwrite,          // the oldest records are dropped and counted
+};
+
+inline constexpr uint32_t TraceLevelSize = 256;
+
+/** *****************************
+//  TraceRing
+//  single producer (its thread), single consumer (flushTraces()).
+//  The records are contiguous, at the end of the ring a header with
+//  size 0 sends the consumer back to the start. The producer never
+//  waits on the consumer: Drop and Overwrite are wait-free. Overwrite
+//  moves the tail, so the consumer copies a record and then claims it
+//  with a compare-exchange of the tail: a copy overwritten meanwhile is
+//  discarded
+****************************** **/
+struct TraceRing
+{
+    static constexpr uint32_t Capacity = TRACE_RING_SIZE;
+    static constexpr uint32_t Mask     = Capacity - 1;
+
+    alignas(64) std::atomic<uint64_t> head        { 0 };    // producer
+                uint64_t              pending     = 0;      // producer: head after commit()
+                std::atomic<uint64_t> dropped     { 0 };    // producer
+                std::atomic<uint64_t> overwritten { 0 };    // producer
+    alignas(64) std::atomic<uint64_t> tail        { 0 };    // consumer, and producer on Overwrite
+                std::atomic<bool>     isClosed    { false };
+    alignas(64) char                  data[Capacity];
+
+    // size 0: the rest of the ring is skipped
+    uint32_t readRecordSize(uint64_t position) const
+    {
+        uint32_t size = 0;
+        memcpy(&size, data + (position & Mask), sizeof(uint32_t));
+        return size;
+    }
+
+    uint32_t getSkipSize(uint64_t position) const
+    {
+        return Capacity - (uint32_t)(position & Mask);
+    }
+
+    // producer: room for a record of 'size' bytes, nullptr if full
+    char* reserve(uint32_t size, TraceOverflow overflow)
+    {
+        uint64_t h      = head.load(std::memory_order_relaxed);
+        uint32_t toEnd  = Capacity - (uint32_t)(h & Mask);
+        uint64_t needed = size + (toEnd < size ? toEnd : 0);
+        uint64_t t      = tail.load(std::memory_order_acquire);
+
+        while(Capacity - (h - t) < needed)
+        {
+            if (overflow != TraceOverflow::Overwrite) return nullptr;
+
+            // the producer wrote the oldest record, it can read its size
+            uint32_t oldestSize = readRecordSize(t);
+            bool     isRecord   = (oldestSize != 0);
+
+            if (isRecord == false) oldestSize = getSkipSize(t);
+
+            if (tail.compare_exchange_weak(t, t + oldestSize, std::memory_order_acq_rel) == true)
+            {
+                if (isRecord == true) overwritten.fetch_add(1, std::memory_order_relaxed);
+                t += oldestSize;
+            }
+        }
+
+        if (toEnd < size)
+        {
+            uint32_t skipSize = 0;
+            memcpy(data + (h & Mask), &skipSize, sizeof(uint32_t));
+            h += toEnd;
+        }
+
+        pending = h + size;
+        return data + (h & Mask);
+    }
+
+    void commit()
+    {
+        head.store(pending, std::memory_order_release);
+    }
+
+    // consumer: calls func(header, args) for every record, from a copy in 'scratch'
+    template<typename Func>
+    size_t drain(char* scratch, Func&& func)
+    {
+        uint64_t t     = tail.load(std::memory_order_acquire);
+        uint64_t h     = head.load(std::memory_order_acquire);
+        size_t   count = 0;
+
+        // on Overwrite the tail can move past 'h'
+        while(t < h)
+        {
+            uint32_t size     = readRecordSize(t);
+            bool     isRecord = (size != 0);
+
+            if (isRecord == false)
+            {
+                size = getSkipSize(t);
+            }
+            else if (size > Capacity / 2 || size > getSkipSize(t))
+            {
+                // being overwritten, the tail has already moved
+                t = tail.load(std::memory_order_acquire);
+                continue;
+            }
+            else
+            {
+                memcpy(scratch, data + (t & Mask), size);
+            }
+
+            // the producer overwrote it meanwhile: continue from the new tail
+            if (tail.compare_exchange_strong(t, t + size, std::memory_order_acq_rel) == false)
+                continue;
+
+            t += size;
+
+            if (isRecord == true)
+            {
+                TraceRecordHeader header;
+                memcpy(&header, scratch, sizeof(header));
+                func(header, scratch + sizeof(header));
+                count++;
+            }
+        }
+
+        return count;
+    }
+};
+
+/** *****************************
+//  binary trace files
+//  TraceFileHeader, then the records as in the ring, with the format ID
+//  instead of the TraceFormat pointer. printfcheck-decode prints them
+****************************** **/
+enum class TraceOutput : uint8_t
+{
+    Text,
+    Binary,
+};
+
+struct TraceFileHeader
+{
+    char     magic[8] = { 'P', 'F', 'C', 'T', 'R', 'A', 'C', 'E' };
+    uint32_t version  = 1;
+    uint32_t reserved = 0;
+};
+
+struct TraceFileRecordHeader
+{
+    uint32_t size     = 0;
+    uint32_t reserved = 0;
+    uint64_t id       = 0;
+};
+
+static_assert(sizeof(TraceFileRecordHeader) == sizeof(TraceRecordHeader), "binary records keep the ring layout");
+
+/** *****************************
+//  TraceRegistry
+//  owns the rings of every thread: a ring is freed once its thread has
+//  exited and it is empty
+****************************** **/
+struct TraceRegistry
+{
+    std::mutex                              consumerMutex;  // one consumer at a time, also owns 'rings'
+    std::vector<std::unique_ptr<TraceRing>> rings;
+    std::unique_ptr<char[]>                 scratch;        // copy of the record being printed
+    uint64_t                                dropped     = 0;    // of the freed rings
+    uint64_t                                overwritten = 0;
+    std::atomic<TraceOverflow>              overflow[TraceLevelSize] = {};
+    std::mutex                              newRingsMutex;
+    std::vector<std::unique_ptr<TraceRing>> newRings;
+    std::thread                             consumer;
+    std::atomic<bool>                       isRunning { false };
+    FILE*                                   file      = nullptr;    // nullptr: stdout
+    TraceOutput                             output    = TraceOutput::Text;
+
+    ~TraceRegistry();
+};
+
+inline TraceRegistry traceRegistry;
+
+struct TraceRingOwner
+{
+    TraceRing* ring = nullptr;
+
+    ~TraceRingOwner()
+    {
+        if (ring != nullptr) ring->isClosed.store(true, std::memory_order_release);
+    }
+};
+
+inline thread_local TraceRingOwner traceRingOwner;
+
+inline
+TraceRing&
+getTraceRing()
+{
+    if (traceRingOwner.ring == nullptr)
+    {
+        auto ring = std::make_unique<TraceRing>();
+        traceRingOwner.ring = ring.get();
+
+        std::lock_guard<std::mutex> lock(traceRegistry.newRingsMutex);
+        traceRegistry.newRings.push_back(std::move(ring));
+    }
+
+    return *traceRingOwner.ring;
+}
+
+inline
+FILE*
+getTraceFile()
+{
+    return traceRegistry.file != nullptr ? traceRegistry.file : stdout;
+}
+
+/** *****************************
+//  flushTraces()
+//  prints the pending records of every thread, in order per thread.
+//  Returns the number of records
+****************************** **/
+inline
+size_t
+flushTraces()
+{
+    std::lock_guard<std::mutex> lock(traceRegistry.consumerMutex);
+
+    {
+        std::lock_guard<std::mutex> newRingsLock(traceRegistry.newRingsMutex);
+
+        for(auto& ring : traceRegistry.newRings) traceRegistry.rings.push_back(std::move(ring));
+        traceRegistry.newRings.clear();
+    }
+
+    if (traceRegistry.scratch == nullptr)
+        traceRegistry.scratch.reset(new char[TraceRing::Capacity / 2]);
+
+    FILE*       file   = getTraceFile();
+    TraceOutput output = traceRegistry.output;
+    size_t      count  = 0;
+
+    for(auto& ring : traceRegistry.rings)
+    {
+        // closed before the drain: nothing else can be written to it
+        bool isClosed = ring->isClosed.load(std::memory_order_acquire);
+
+        count += ring->drain(traceRegistry.scratch.get(), [file, output](const TraceRecordHeader& header, const char* args)
+        {
+            if (output == TraceOutput::Text)
+            {
+                header.format->decode(file, args);
+                return;
+            }
+
+            TraceFileRecordHeader fileHeader = {};
+            fileHeader.size = header.size;
+            fileHeader.id   = header.format->id;
+
+            fwrite(&fileHeader, sizeof(fileHeader), 1, file);
+            fwrite(args, header.size - sizeof(fileHeader), 1, file);
+        });
+
+        if (isClosed == true)
+        {
+            traceRegistry.dropped     += ring->dropped.load(std::memory_order_relaxed);
+            traceRegistry.overwritten += ring->overwritten.load(std::memory_order_relaxed);
+            ring.reset();
+        }
+    }
+
+    traceRegistry.rings.erase(std::remove(traceRegistry.rings.begin(), traceRegistry.rings.end(), nullptr),
+                              traceRegistry.rings.end());
+
+    if (count > 0) fflush(file);
+
+    return count;
+}
+
+/** *****************************
+//  setTraceOverflow(), getDroppedTraces(), getOverwrittenTraces()
+//  the policy of a level, of every level without 'level'. Levels from
+//  TraceLevelSize up share the policy of the last one
+****************************** **/
+inline
+uint32_t
+getTraceLevelIndex(int level)
+{
+    return (uint32_t)level < TraceLevelSize ? (uint32_t)level : TraceLevelSize - 1;
+}
+
+inline
+void
+setTraceOverflow(int level, TraceOverflow overflow)
+{
+    traceRegistry.overflow[getTraceLevelIndex(level)].store(overflow, std::memory_order_relaxed);
+}
+
+inline
+void
+setTraceOverflow(TraceOverflow overflow)
+{
+    for(auto& levelOverflow : traceRegistry.overflow) levelOverflow.store(overflow, std::memory_order_relaxed);
+}
+
+template<typename Counter>
+inline
+uint64_t
+sumTraceCounter(Counter counter, uint64_t freedRings)
+{
+    std::lock_guard<std::mutex> lock(traceRegistry.consumerMutex);
+    std::lock_guard<std::mutex> newRingsLock(traceRegistry.newRingsMutex);
+
+    uint64_t total = freedRings;
+
+    for(auto& ring : traceRegistry.rings)    total += ((*ring).*counter).load(std::memory_order_relaxed);
+    for(auto& ring : traceRegistry.newRings) total += ((*ring).*counter).load(std::memory_order_relaxed);
+
+    return total;
+}
+
+inline
+uint64_t
+getDroppedTraces()
+{
+    return sumTraceCounter(&TraceRing::dropped, traceRegistry.dropped);
+}
+
+inline
+uint64_t
+getOverwrittenTraces()
+{
+    return sumTraceCounter(&TraceRing::overwritten, traceRegistry.overwritten);
+}
+
+/** *****************************
+//  startTraceConsumer(), stopTraceConsumer()
+//  a thread printing the records into 'file', as text or as a binary
+//  trace. Without it the records are printed by flushTraces(), when a
+//  ring is full and at exit
+****************************** **/
+inline
+void
+stopTraceConsumer()
+{
+    if (traceRegistry.isRunning.exchange(false) == true)
+        traceRegistry.consumer.join();
+
+    flushTraces();
+}
+
+inline
+void
+startTraceConsumer(FILE* file = stdout, TraceOutput output = TraceOutput::Text)
+{
+    stopTraceConsumer();
+
+    // a single header per file, also when the consumer is restarted
+    if (output == TraceOutput::Binary && ftell(file) <= 0)
+    {
+        TraceFileHeader fileHeader = {};
+        fwrite(&fileHeader, sizeof(fileHeader), 1, file);
+    }
+
+    traceRegistry.file   = file;
+    traceRegistry.output = output;
+    traceRegistry.isRunning.store(true);
+    traceRegistry.consumer = std::thread([]()
+    {
+        while(traceRegistry.isRunning.load(std::memory_order_relaxed) == true)
+        {
+            if (flushTraces() == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+}
+
+inline
+TraceRegistry::~TraceRegistry()
+{
+    stopTraceConsumer();
+}
+
+/** *****************************
+//  packed arguments
+//  a value is copied as is. A string of a '%s' field is copied by length,
+//  limited by the precision, and with its '\0': [uint32 length][chars]['\0']
+****************************** **/
+enum class TraceArgKind : uint8_t
+{
+    Value,
+    String,
+    StringPrecision,            // "%.10s"
+    StringStarPrecision,        // "%.*s": the precision is the previous argument
+};
+
+struct TraceArgDesc
+{
+    TraceArgKind kind      = TraceArgKind::Value;
+    int32_t      precision = -1;
+};
+
+template<typename Fmt, std::size_t ArgsSize>
+CONSTEVAL
+auto
+makeTraceArgDescs()
+-> std::array<TraceArgDesc, ArgsSize + 1>
+{
+    constexpr auto Table = parseFmtFields<std::string_view(Fmt::value()).size() / 2>(Fmt::value());
+
+    std::array<TraceArgDesc, ArgsSize + 1> descs = {};
+    std::size_t ArgIndex = 0;
+
+    for(uint32_t i = 0; i < Table.size; i++)
+    {
+        const FmtFieldDesc& Field = Table.fields[i];
+
+        ArgIndex += Field.starCount;
+        if (ArgIndex >= ArgsSize) break;
+
+        if (Field.conversion == 's')
+        {
+            bool isStarPrecision = Field.starCount > 0 && Field.precision < 0 &&
+                                   std::string_view(Fmt::value() + Field.offset, Field.size).find(".*") != std::string_view::npos;
+
+            if      (isStarPrecision == true) descs[ArgIndex].kind = TraceArgKind::StringStarPrecision;
+            else if (Field.precision >= 0)    descs[ArgIndex].kind = TraceArgKind::StringPrecision;
+            else                              descs[ArgIndex].kind = TraceArgKind::String;
+
+            descs[ArgIndex].precision = Field.precision;
+        }
+
+        ArgIndex++;
+    }
+
+    return descs;
+}
+
+//  "%n" writes into its argument: it can't be deferred, nor the strings
+//  of ENABLE_PRINTF_STRING
+template<typename Fmt, typename... Args>
+CONSTEVAL
+bool
+isTraceDeferrable()
+{
+    constexpr auto Table = parseFmtFields<std::string_view(Fmt::value()).size() / 2>(Fmt::value());
+
+    for(uint32_t i = 0; i < Table.size; i++)
+    {
+        if (Table.fields[i].isValid == false || Table.fields[i].conversion == 'n') return false;
+    }
+
+    return ((std::is_trivially_copyable_v<Args> && isFmtString<Args>() == false) && ...);
+}
+
+template<TraceArgKind Kind, typename T>
+inline
+uint32_t
+getTraceArgSize(T arg, int32_t precision, uint32_t& length, int64_t& previous)
+{
+    if constexpr (Kind == TraceArgKind::Value)
+    {
+        if constexpr (std::is_integral_v<T>) previous = (int64_t)arg;
+        return sizeof(T);
+    }
+    else
+    {
+        if (arg == nullptr)
+        {
+            length = TraceStringNull;
+            return sizeof(uint32_t);
+        }
+
+        if constexpr (Kind == TraceArgKind::StringStarPrecision) precision = previous >= 0 && previous <= INT32_MAX ? (int32_t)previous : -1;
+
+        if (Kind != TraceArgKind::String && precision >= 0)
+        {
+            const void* end = memchr(arg, '\0', (size_t)precision);
+            length = end != nullptr ? (uint32_t)((const char*)end - arg) : (uint32_t)precision;
+        }
+        else
+        {
+            size_t size = strlen(arg);
+            length = size < TraceRing::Capacity ? (uint32_t)size : TraceRing::Capacity;
+        }
+
+        return sizeof(uint32_t) + length + 1;
+    }
+}
+
+template<TraceArgKind Kind, typename T>
+inline
+char*
+writeTraceArg(char* out, T arg, uint32_t length)
+{
+    if constexpr (Kind == TraceArgKind::Value)
+    {
+        memcpy(out, &arg, sizeof(T));
+        return out + sizeof(T);
+    }
+    else
+    {
+        memcpy(out, &length, sizeof(uint32_t));
+        out += sizeof(uint32_t);
+
+        if (length == TraceStringNull) return out;
+
+        memcpy(out, arg, length);
+        out[length] = '\0';
+        return out + length + 1;
+    }
+}
+
+//  the size of a packed argument, and its value: the strings point into the record
+template<TraceArgKind Kind, typename T>
+inline
+uint32_t
+getPackedTraceArgSize(const char* in)
+{
+    if constexpr (Kind == TraceArgKind::Value)
+    {
+        return sizeof(T);
+    }
+    else
+    {
+        uint32_t length = 0;
+        memcpy(&length, in, sizeof(uint32_t));
+        return length == TraceStringNull ? sizeof(uint32_t) : sizeof(uint32_t) + length + 1;
+    }
+}
+
+template<TraceArgKind Kind, typename T>
+inline
+auto
+readTraceArg(const char* in)
+{
+    if constexpr (Kind == TraceArgKind::Value)
+    {
+        T value;
+        memcpy(&value, in, sizeof(T));
+        return value;
+    }
+    else
+    {
+        uint32_t length = 0;
+        memcpy(&length, in, sizeof(uint32_t));
+        return length == TraceStringNull ? (const char*)nullptr : in + sizeof(uint32_t);
+    }
+}
+
+template<typename Fmt, typename... Args, std::size_t... I>
+inline
+int
+decodeTraceArgs(FILE* file, [[maybe_unused]] const char* args, std::index_sequence<I...>)
+{
+    [[maybe_unused]] constexpr auto Descs = makeTraceArgDescs<Fmt, sizeof...(Args)>();
+
+    [[maybe_unused]] const char* argData[sizeof...(Args) + 1] = {};
+    ((argData[I] = args, args += getPackedTraceArgSize<Descs[I].kind, Args>(args)), ...);
+
+    return fprintfFast<Fmt>(file, Fmt::value(), readTraceArg<Descs[I].kind, Args>(argData[I])...);
+}
+
+template<typename Fmt, typename... Args>
+int
+decodeTrace(FILE* file, const char* args)
+{
+    return decodeTraceArgs<Fmt, Args...>(file, args, std::index_sequence_for<Args...>{});
+}
+
+/** *****************************
+//  "printfcheck_fmts" section
+//  an entry per deferred TRACEPRINT() site, without pointers so it can
+//  be read from the ELF file: TraceSectionHeader, the argument types,
+//  the fields, the fmt and __FILE__. The ID hashes the fmt and the
+//  argument types.
+//  GCC ignores the section of template data and leaves the entries in
+//  their COMDAT .rodata sections: the decoder also finds them by their
+//  magic and their ID
+****************************** **/
+enum class TraceArgType : uint8_t
+{
+    Other,
+    Signed,
+    Unsigned,
+    Floating,
+    Pointer,
+    String,
+};
+
+struct TraceArgInfo
+{
+    TraceArgType type     = TraceArgType::Other;
+    uint8_t      reserved = 0;
+    uint16_t     size     = 0;                  // bytes in the record, strings have their own length
+};
+
+struct TraceSectionHeader
+{
+    char     magic[8]   = { 'P', 'F', 'C', 'F', 'M', 'T', '0', '1' };
+    uint64_t id         = 0;
+    uint32_t entrySize  = 0;
+    uint32_t line       = 0;
+    uint16_t argCount   = 0;
+    uint16_t fieldCount = 0;
+    uint32_t fmtSize    = 0;                    // with the '\0'
+    uint32_t fileSize   = 0;
+    uint32_t flags      = 0;                    // FmtIdFileLine
+};
+
+struct TraceSectionLayout
+{
+    uint32_t args   = 0;
+    uint32_t fields = 0;
+    uint32_t fmt    = 0;
+    uint32_t file   = 0;
+    uint32_t size   = 0;
+};
+
+//  offsets in an entry, the decoder finds the parts with it
+constexpr
+TraceSectionLayout
+getTraceSectionLayout(uint32_t argCount, uint32_t fieldCount, uint32_t fmtSize, uint32_t fileSize)
+{
+    TraceSectionLayout layout = {};
+
+    layout.args   = sizeof(TraceSectionHeader);
+    layout.fields = layout.args   + (argCount   + 1) * (uint32_t)sizeof(TraceArgInfo);
+    layout.fmt    = layout.fields + (fieldCount + 1) * (uint32_t)sizeof(FmtFieldDesc);
+    layout.file   = layout.fmt    + fmtSize;
+    layout.size   = (layout.file + fileSize + 7) & ~7u;
+
+    return layout;
+}
+
+template<uint32_t ArgCount, uint32_t FieldCount, uint32_t FmtSize, uint32_t FileSize>
+struct alignas(8) TraceSectionEntry
+{
+    TraceSectionHeader header                 = {};
+    TraceArgInfo       args  [ArgCount + 1]   = {};
+    FmtFieldDesc       fields[FieldCount + 1] = {};
+    char               fmt   [FmtSize]        = {};
+    char               file  [FileSize]       = {};
+};
+
+template<typename T, TraceArgKind Kind>
+CONSTEVAL
+TraceArgInfo
+makeTraceArgInfo()
+{
+    TraceArgInfo info = {};
+    info.size = sizeof(T);
+
+    if      constexpr (Kind != TraceArgKind::Value)     info.type = TraceArgType::String;
+    else if constexpr (std::is_floating_point_v<T>)     info.type = TraceArgType::Floating;
+    else if constexpr (std::is_pointer_v<T>)            info.type = TraceArgType::Pointer;
+    else if constexpr (std::is_enum_v<T>)               info.type = std::is_signed_v<std::underlying_type_t<T>> ? TraceArgType::Signed : TraceArgType::Unsigned;
+    else if constexpr (std::is_integral_v<T>)           info.type = std::is_signed_v<T> ? TraceArgType::Signed : TraceArgType::Unsigned;
+
+    return info;
+}
+
+template<typename Fmt, typename... Args, std::size_t... I>
+CONSTEVAL
+auto
+makeTraceArgInfos(std::index_sequence<I...>)
+-> std::array<TraceArgInfo, sizeof...(Args) + 1>
+{
+    [[maybe_unused]] constexpr auto Descs = makeTraceArgDescs<Fmt, sizeof...(Args)>();
+
+    return { makeTraceArgInfo<Args, Descs[I].kind>()... };
+}
+
+//  the site ID and then the type and size of every argument, the
+//  decoder checks the entries found in the binary with it
+constexpr
+uint64_t
+getTraceFormatId(uint64_t siteId, const TraceArgInfo* infos, std::size_t count)
+{
+    uint64_t hash = siteId;
+
+    for(std::size_t i = 0; i < count; i++)
+    {
+        const char info[3] = { (char)infos[i].type, (char)(infos[i].size & 0xFF), (char)(infos[i].size >> 8) };
+        hash = hashFmtFnv1a(std::string_view(info, sizeof(info)), hash);
+    }
+
+    return hash;
+}
+
+template<typename Fmt, typename... Args>
+CONSTEVAL
+auto
+makeTraceSectionEntry()
+{
+    constexpr std::string_view FmtSv  = Fmt::value();
+    constexpr std::string_view FileSv = Fmt::file();
+    constexpr auto             Table  = parseFmtFields<FmtSv.size() / 2>(FmtSv);
+    constexpr auto             Infos  = makeTraceArgInfos<Fmt, Args...>(std::index_sequence_for<Args...>{});
+
+    using Entry = TraceSectionEntry<sizeof...(Args), Table.size, FmtSv.size() + 1, FileSv.size() + 1>;
+    constexpr TraceSectionLayout Layout = getTraceSectionLayout(sizeof...(Args), Table.size, FmtSv.size() + 1, FileSv.size() + 1);
+
+    static_assert(offsetof(Entry, fields) == Layout.fields && offsetof(Entry, fmt) == Layout.fmt &&
+                  offsetof(Entry, file) == Layout.file && sizeof(Entry) == Layout.size, "TraceSectionEntry layout");
+
+    Entry entry = {};
+
+    entry.header.id         = getTraceFormatId(Fmt::id(), Infos.data(), sizeof...(Args));
+    entry.header.entrySize  = sizeof(Entry);
+    entry.header.line       = Fmt::line();
+    entry.header.argCount   = (uint16_t)sizeof...(Args);
+    entry.header.fieldCount = (uint16_t)Table.size;
+    entry.header.fmtSize    = (uint32_t)FmtSv.size() + 1;
+    entry.header.fileSize   = (uint32_t)FileSv.size() + 1;
+    entry.header.flags      = EnableFmtIdFileLine == true ? FmtIdFileLine : 0;
+
+    for(uint32_t i = 0; i < sizeof...(Args); i++) entry.args[i]   = Infos[i];
+    for(uint32_t i = 0; i < Table.size; i++)      entry.fields[i] = Table.fields[i];
+    for(uint32_t i = 0; i < FmtSv.size(); i++)    entry.fmt[i]    = FmtSv[i];
+    for(uint32_t i = 0; i < FileSv.size(); i++)   entry.file[i]   = FileSv[i];
+
+    return entry;
+}
+
+template<typename Fmt, typename... Args>
+[[gnu::used, gnu::section("printfcheck_fmts")]]
+inline constexpr auto TraceSectionEntryOf = makeTraceSectionEntry<Fmt, Args...>();
+
+template<typename Fmt, typename... Args>
+inline constexpr TraceFormat TraceFormatOf = { Fmt::value(), &decodeTrace<Fmt, Args...>,
+                                               TraceSectionEntryOf<Fmt, Args...>.header.id,
+                                               &TraceSectionEntryOf<Fmt, Args...>.header };
+
+/** *****************************
+//  traceDeferred()
+//  sizes the record, then copies the arguments into the ring. A full
+//  ring follows the TraceOverflow of the level. Records that can't be
+//  deferred, or bigger than half the ring, are printed at once
+****************************** **/
+template<typename Fmt, typename... Args>
+inline
+void
+traceNow(Args... args)
+{
+    flushTraces();
+
+    std::lock_guard<std::mutex> lock(traceRegistry.consumerMutex);
+    fprintfFast<Fmt>(getTraceFile(), Fmt::value(), args...);
+}
+
+template<typename Fmt, typename... Args, std::size_t... I>
+inline
+void
+traceDeferredArgs(int level, std::index_sequence<I...>, Args... args)
+{
+    [[maybe_unused]] constexpr auto Descs = makeTraceArgDescs<Fmt, sizeof...(Args)>();
+
+    [[maybe_unused]] uint32_t lengths[sizeof...(Args) + 1];
+    [[maybe_unused]] int64_t  previous = -1;
+    uint32_t                  size     = sizeof(TraceRecordHeader);
+
+    ((size += getTraceArgSize<Descs[I].kind>(args, Descs[I].precision, lengths[I], previous)), ...);
+    size = (size + TraceRecordAlign - 1) & ~(TraceRecordAlign - 1);
+
+    if (size > TraceRing::Capacity / 2)
+    {
+        traceNow<Fmt>(args...);
+        return;
+    }
+
+    TraceRing&    ring     = getTraceRing();
+    TraceOverflow overflow = traceRegistry.overflow[getTraceLevelIndex(level)].load(std::memory_order_relaxed);
+    char*         record   = ring.reserve(size, overflow);
+
+    while(record == nullptr)
+    {
+        if (overflow == TraceOverflow::Drop)
+        {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (traceRegistry.isRunning.load(std::memory_order_relaxed) == true)
+            std::this_thread::yield();
+        else
+            flushTraces();
+
+        record = ring.reserve(size, overflow);
+    }
+
+    TraceRecordHeader header = {};
+    header.size   = size;
+    header.format = &TraceFormatOf<Fmt, Args...>;
+    memcpy(record, &header, sizeof(header));
+
+    char* out = record + sizeof(header);
+    ((out = writeTraceArg<Descs[I].kind>(out, args, lengths[I])), ...);
+    (void)out;
 
-    return FmtError::NoError;
+    ring.commit();
+}
+
+template<typename Fmt, typename... Args>
+inline
+void
+traceDeferred(int level, const char* fmt, Args... args)
+{
+    (void)fmt;
+
+    if constexpr (isTraceDeferrable<Fmt, Args...>() == true)
+        traceDeferredArgs<Fmt>(level, std::index_sequence_for<Args...>{}, args...);
+    else
+        traceNow<Fmt>(args...);
 }
 
+} // namespace printfcheck
+
+#endif /** ENABLE_TRACE_DEFERRED **/
+
+#endif /** !PRINTF_CHECK_MODULE **/
+
+// the fields of the literal: shared FmtFieldsOf<> in C++20, parsed in place otherwise
+#if defined(__cpp_nontype_template_args) && (__cpp_nontype_template_args >= 201911L)
+#define FMT_FIELDS(fmt_literal)            FmtFieldsOf<FmtLiteral(fmt_literal)>
+#else
+#define FMT_FIELDS(fmt_literal)            parseFmtLiteral<(sizeof(fmt_literal) - 1) / 2>(fmt_literal)
+#endif
+
+// the longest output of the literal, without the '\0': a constexpr uint32_t
+#define FMT_MAX_SIZE(fmt_literal)          getFmtMaxSize(FMT_FIELDS(fmt_literal), fmt_literal)
+
+// ENABLE_FMT_ID_TABLE: the entry is referenced, so it's in the binary.
+// Not with 'if constexpr': out of a template it would be instantiated
+#ifdef ENABLE_FMT_ID_TABLE
+#define FMT_ID_ENTRY(fmt_literal)          do{ FMT_LITERAL_TYPE(fmt_literal); (void)&FmtIdEntryOf<FmtLiteralType>; }while(0)
+#else
+#define FMT_ID_ENTRY(fmt_literal)          do{ }while(0)
+#endif
+
 /** *************************************** **/
 /**             PRINTF_CHECK                **/
 /** *************************************** **/
-#define  PRINTF_CHECK(fmt_literal, ...)                do{                          \
-            constexpr uint32_t FmtSize = sizeof(fmt_literal) - 1;                   \
+//  the checks are inside a dead branch: they are compiled, static_assert
+//  and static_warning work, but no code, stack or symbol is generated
+#define  PRINTF_CHECK(fmt_literal, ...)                do{ if(false) {              \
+            /** Compile-time Args **/                                               \
+            using ArgsTypeList = decltype(captureArgTypes(__VA_ARGS__));            \
                                                                                     \
-            constexpr int ArgsSize = GET_ARG_COUNT(__VA_ARGS__);                    \
+            constexpr int ArgsSize = ArgsTypeList::size;                            \
+                                                                                    \
+            /** ************************************************ **/                \
+            /** A.0) Parse the Fmt once and run the checks       **/                \
+            /** ************************************************ **/                \
+            constexpr                                                               \
+            FmtCheckResult FmtCheck = checkFmt(FMT_FIELDS(fmt_literal),             \
+                                               FmtArgTable<ArgsTypeList>::value);   \
                                                                                     \
             /** ************************************************ **/                \
             /** A.1) Check Fmt & Args Size                       **/                \
             /** ************************************************ **/                \
             constexpr                                                               \
-            int FmtFieldCounter =                                                   \
-                constexpr_for_arg_counter<0, FmtSize>(                              \
-                        [](uint32_t Index)                                          \
-                        {                                                           \
-                            return getFieldIndices(fmt_literal, Index);             \
-                        }                                                           \
-                    );                                                              \
+            int FmtFieldCounter = getFmtArgCounter(FmtCheck);                       \
                                                                                     \
             static_assert(FmtFieldCounter <= ArgsSize,                              \
                     " Too few arguments. fmt: " #fmt_literal);                      \
                                                                                     \
-            /** Compile-time Args **/                                               \
-            using TupleArgsType = std::tuple<GET_DECLTYPE_OF_N(__VA_ARGS__)>;       \
-                                                                                    \
             /** ************************************************ **/                \
             /** A.2) Check Argument mismatch                     **/                \
             /** ************************************************ **/                \
             constexpr                                                               \
-            auto errorCode =                                                        \
-            constexpr_for_check_Field<0, FmtSize, 0, TupleArgsType>(                \
-                    [](uint32_t Index)                                              \
-                    {                                                               \
-                        return getFieldIndices(fmt_literal, Index);                 \
-                    }                                                               \
-                );                                                                  \
+            auto errorCode = getFmtErrorCode(FmtCheck);                             \
             if(errorCode != FmtError::NoError)                                      \
             {                                                                       \
                 static_assert(errorCode != FmtError::ErrorString,                   \
@@ -666,24 +4758,76 @@ constexpr_for_check_Field (F func)
             if constexpr(DisableFmtFieldValidity == false)                          \
             {                                                                       \
                 constexpr                                                           \
-                auto warningCode =                                                  \
-                constexpr_for_valididy<0, FmtSize>(                                 \
-                            [](uint32_t Index)                                      \
-                            {                                                       \
-                                return getFieldIndicesWithoutCheck(fmt_literal, Index);     \
-                            }                                                       \
-                        );                                                          \
+                auto warningCode = getFmtWarningCode(FmtCheck);                     \
                                                                                     \
                 static_warning(warningCode != FmtError::WarningFieldValidity,       \
                                "fmt fields aren't conformant " #fmt_literal);       \
                                                                                     \
             } /** !DisableFmtFieldValidity **/                                      \
                                                                                     \
-            }while(0)
+            /** ************************************************ **/                \
+            /** A.6) ID of the call site (Optional)              **/                \
+            /** ************************************************ **/                \
+            FMT_ID_ENTRY(fmt_literal);                                              \
+                                                                                    \
+            }}while(0)
+
+/** *************************************** **/
+/**         PRINTF_CHECK_BUFSIZE            **/
+/** *************************************** **/
+//  snprintf(): warns when a constant BUFSIZE is below the bound of the
+//  fmt. A BUFSIZE that isn't a constant, 0 to get the size, or a fmt
+//  without bound aren't checked
+#define  PRINTF_CHECK_BUFSIZE(bufsize, fmt_literal, ...)   do{ if(false) {          \
+            constexpr uint32_t FmtMaxSize = FMT_MAX_SIZE(fmt_literal);              \
+            constexpr uint64_t FmtBufSize =                                         \
+                __builtin_constant_p(bufsize) ? (uint64_t)(bufsize) : 0;            \
+                                                                                    \
+            static_warning(DisableBufferSizeCheck == true ||                        \
+                           FmtBufSize == 0 || FmtMaxSize == FmtSizeUnbounded ||     \
+                           FmtBufSize > FmtMaxSize,                                 \
+                "snprintf() BUFSIZE is below the longest output fmt: " #fmt_literal); \
+            }}while(0)
+
+/** *************************************** **/
+/**        PRINTF_FAST, TRACEPRINT_FAST     **/
+/** *************************************** **/
+//  checked like printf(), and formatted by a formatter specialized for
+//  the fmt literal: "%d", "%i", "%u", "%x", "%X", "%s" and "%c" with
+//  '-', '0', width and length. Other fmts are printed by printf()
+#define PRINTF_FAST(...)                    do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); FMT_CONST_CALL(stdout, fprintfFast<FmtLiteralType>(stdout, __VA_ARGS__), __VA_ARGS__);    }while(0)
+#define FPRINTF_FAST(File, ...)             do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); FMT_CONST_CALL(File, fprintfFast<FmtLiteralType>(File, __VA_ARGS__), __VA_ARGS__);        }while(0)
+#define SNPRINTF_FAST(BUFFER, BUFSIZE, ...) do{ PRINTF_CHECK(__VA_ARGS__); PRINTF_CHECK_BUFSIZE(BUFSIZE, __VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); snprintfFast<FmtLiteralType>(BUFFER, BUFSIZE, __VA_ARGS__); }while(0)
+
+#define TRACEPRINT_FAST(index, level, ...)  do{ PRINTF_CHECK(__VA_ARGS__); FMT_LITERAL_TYPE(__VA_ARGS__); TRACE_IF_COMPILED(level, FMT_CONST_CALL(stdout, fprintfFast<FmtLiteralType>(stdout, __VA_ARGS__), __VA_ARGS__)); }while(0)
+
+/** *************************************** **/
+/**             PRINTF_TO_STACK             **/
+/** *************************************** **/
+//  the output in a FmtStackString of the caller's frame, sized by
+//  FMT_MAX_SIZE(): .c_str(), .view() and .size. No heap, no truncation
+#define PRINTF_TO_STACK(...)                [&]() __attribute__((always_inline))    \
+                                            {                                       \
+                                                PRINTF_CHECK(__VA_ARGS__);          \
+                                                FMT_LITERAL_TYPE(__VA_ARGS__);      \
+                                                return printfToStack<FmtLiteralType>(__VA_ARGS__); \
+                                            }()
 
 /** *************************************** **/
 /**   TESTs                                 **/
 /** *************************************** **/
+#include <chrono>
+#include <climits>
+#include <string>
+#if defined(ENABLE_TRACE_DEFERRED) || defined(ENABLE_PRINTF_PROFILE) || defined(ENABLE_FMT_VALIDATE)
+#include <thread>
+#include <vector>
+#endif
+#ifdef ENABLE_TRACE_SITES
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
 #define FMT_DEBUG_ALL                      1
 #define FMT_DEBUG_ERROR_ARGS_MISMATCH      0
 #define FMT_DEBUG_WARN_ARGS_MISMATCH       0
@@ -694,11 +4838,52 @@ constexpr_for_check_Field (F func)
 #define FMT_DEBUG_ERROR_VARIABLE_WIDTH     0
 #define FMT_DEBUG_ERROR_FIELD_N            0
 #define FMT_DEBUG_WARNING_FLOAT_FIELD      0
+#define FMT_DEBUG_WARN_BUFFER_SIZE         0
+
+#define FMT_BENCH_FAST                     0
+#define FMT_BENCH_TRACE                    0   // with ENABLE_TRACE_DEFERRED
+#define FMT_BENCH_SITES                    0   // with ENABLE_TRACE_SITES
+#define FMT_BENCH_PROFILE                  0   // with ENABLE_PRINTF_PROFILE or ENABLE_PRINTF_LATENCY
+#define FMT_BENCH_VALIDATE                 0   // with ENABLE_FMT_VALIDATE
+#define FMT_BENCH_STRING                   0   // with ENABLE_PRINTF_STRING
 
 #define LOG_DEBUG 0xFF
 
+// a failed test prints its line, and main() returns 1
+static int testFailures = 0;
+
+#define TEST_EXPECT(condition, ...)                                             \
+            do{ if ((condition) == false) {                                     \
+                testFailures++;                                                 \
+                printf("FAILED line %d: ", __LINE__);                           \
+                printf(__VA_ARGS__);                                            \
+            } }while(0)
+
+// SNPRINTF_FAST() against snprintf(), of the same fmt and arguments
+#define TEST_FAST(...)                                                          \
+            do{ char fastText[2048];                                            \
+                char libcText[2048];                                            \
+                SNPRINTF_FAST(fastText, sizeof(fastText), __VA_ARGS__);         \
+                (snprintf)(libcText, sizeof(libcText), __VA_ARGS__);            \
+                TEST_EXPECT(strcmp(fastText, libcText) == 0, "fast: '%s' instead of '%s'\n", fastText, libcText); \
+            }while(0)
+
+// 4KB fmt with 60 fields
+#define FMT_REPEAT_4(s)    s s s s
+#define FMT_REPEAT_20(s)   FMT_REPEAT_4(s) FMT_REPEAT_4(s) FMT_REPEAT_4(s) FMT_REPEAT_4(s) FMT_REPEAT_4(s)
+#define FMT_REPEAT_60(s)   FMT_REPEAT_20(s) FMT_REPEAT_20(s) FMT_REPEAT_20(s)
+#define FMT_LONG_4KB       FMT_REPEAT_60("  [long diagnostic field of a 4KB trace line ....................] = %d\n")
+
+#define ARG_REPEAT_4(a)    a, a, a, a
+#define ARG_REPEAT_20(a)   ARG_REPEAT_4(a), ARG_REPEAT_4(a), ARG_REPEAT_4(a), ARG_REPEAT_4(a), ARG_REPEAT_4(a)
+#define ARG_REPEAT_60(a)   ARG_REPEAT_20(a), ARG_REPEAT_20(a), ARG_REPEAT_20(a)
+
 int main()
 {
+    #ifdef ENABLE_TRACE_DEFERRED
+    printfcheck::startTraceConsumer(stdout);
+    #endif
+
     printf("main starts\n");
 
     printf("Starts... \n");
@@ -745,6 +4930,11 @@ int main()
     TRACEPRINT(1, LOG_DEBUG, "TEST float: %4.2f \n", 5);
     #endif
 
+    #if FMT_DEBUG_WARN_BUFFER_SIZE == 1
+    char smallBuffer[8];
+    snprintf(smallBuffer, sizeof(smallBuffer), "TEST: %d", 5);
+    #endif
+
     #if FMT_DEBUG_ALL == 1  // ALL IF
     // -------------------
     // from https://en.cppreference.com/w/c/io/fprintf
@@ -787,6 +4977,7 @@ int main()
     TRACEPRINT(1, LOG_DEBUG, "Esto no es %%%d \n", 777);
     TRACEPRINT(1, LOG_DEBUG, "Esto si %%%s \n", "this");
     TRACEPRINT(1, LOG_DEBUG, "Esto si %%%.*s \n", 2, "this");
+    TRACEPRINT(1, LOG_DEBUG, "Esto no es %%d, esto si %d \n", 5);
     // TRACEPRINT(1, LOG_DEBUG, "Esto no es %%d \n", 5);    // just warning
 
     // -------------------
@@ -840,6 +5031,10 @@ int main()
 
     TRACEPRINT(1, LOG_DEBUG, "%d %u %x %f %4.2f %ld %hd %hhd %s %.*s \n", 1, 2, 3, 4.0f, 5.0f, 6, 7, 8, "array", 2, "var_array");
 
+    // more than 16 arguments
+    TRACEPRINT(1, LOG_DEBUG, "%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %s %.*s \n",
+                              1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, "array", 2, "var_array");
+
     FILE* file = nullptr;
     if(file) fprintf(file, "%d %u %x \n", 1, 2, 3);
     char buffer[50];
@@ -864,12 +5059,700 @@ int main()
     // TRACEPRINT(1, LOG_DEBUG, "complex test %.*s \n", 5, dummyStr);
     // TRACEPRINT(1, LOG_DEBUG, "complex test %.*s \n", "not a number", "array");
 
-    static_assert(GET_ARG_COUNT()      == 0, "failed for 0 arguments");
-    static_assert(GET_ARG_COUNT(1)     == 1, "failed for 1 argument");
-    static_assert(GET_ARG_COUNT(1,2)   == 2, "failed for 2 argument");
-    static_assert(GET_ARG_COUNT(1,2,3) == 3, "failed for 3 argument");
+    // 4KB fmt with 60 fields, checked without a template instantiation per field
+    constexpr auto LongFmtFields = parseFmtFields<(sizeof(FMT_LONG_4KB) - 1) / 2>(FMT_LONG_4KB);
+
+    static_assert(sizeof(FMT_LONG_4KB) - 1 >= 4096,  "fmt isn't 4KB long");
+    static_assert(LongFmtFields.size == 60,          "failed for 60 fields");
+    static_assert(countFmtArgs(LongFmtFields) == 60, "failed for 60 arguments");
+
+    PRINTF_CHECK(FMT_LONG_4KB, ARG_REPEAT_60(7));
+
+    // -------------------
+    // PRINTF_FAST: same output as printf()
+    // -------------------
+    PRINTF_FAST("fast: %d %i %u %x %X %c %s %%\n", -1, 2, 3u, 0xab, 0xcd, 'F', "array");
+    PRINTF_FAST("fast: [%5d] [%-5d] [%05d] [%08x] [%10s] [%-10s] [%3c]\n", -12, 34, -56, 0xbeef, "right", "left", 'c');
+    PRINTF_FAST("fast: %hhd %hd %ld %lld %zu %jd %td\n", 300, 70000, -8L, -9LL, (size_t)10, (intmax_t)11, (ptrdiff_t)12);
+    TRACEPRINT_FAST(1, LOG_DEBUG, "fast: no fields %%\n");
+    TRACEPRINT_FAST(1, LOG_DEBUG, "fast: printf() fallback %.*s %4.2f %+d\n", 3, "array", 7.5, 8);
+
+    // the truncation with a size that isn't a constant: no -Wformat-truncation of the printf() fallback
+    char            fastBuffer[16];
+    volatile size_t fastBufferSize = sizeof(fastBuffer);
+    SNPRINTF_FAST(fastBuffer, fastBufferSize, "%s %d %d", "truncated", 1234, 5678);
+    printf("fast: '%s'\n", fastBuffer);
+
+    TEST_EXPECT(strlen(fastBuffer) == sizeof(fastBuffer) - 1, "fast: truncation to %zu\n", strlen(fastBuffer));
+
+    // the same output as snprintf(), for every conversion, flag, width and length of the fast path
+    const char* volatile nullText = nullptr;     // a NULL that isn't a constant: no -Wformat-truncation
+    std::string longText(1004, 'l');
+    std::string tailText(200, 't');
+
+    TEST_FAST("%d %i %u %x %X %c %s %%", -1, 2, 3u, 0xab, 0xcd, 'F', "array");
+    TEST_FAST("%d %d %u %x %X", INT_MIN, INT_MAX, UINT_MAX, 0u, UINT_MAX);
+    TEST_FAST("[%5d] [%-5d] [%05d] [%5i] [%05i] [%08x] [%-8X] [%3u]", -12, 34, -56, 8, -9, 0xbeef, 0xbeef, 12345u);
+    TEST_FAST("[%30d] [%-30d] [%030d] [%025llu]", INT_MIN, INT_MIN, INT_MIN, ULLONG_MAX);
+    TEST_FAST("%hhd %hhu %hhx %hd %hu %hX", 300, 300, -1, 70000, -1, 70000);
+    TEST_FAST("%ld %lu %lx %lld %llu %llX", LONG_MIN, ULONG_MAX, -1L, LLONG_MIN, ULLONG_MAX, ULLONG_MAX);
+    TEST_FAST("%zd %zu %zx %jd %ju %td %tu", (ptrdiff_t)-10, SIZE_MAX, (size_t)0xff, INTMAX_MIN, UINTMAX_MAX, PTRDIFF_MIN, (size_t)12);
+    TEST_FAST("[%s] [%10s] [%-10s] [%s] [%3s] [%-3s]", "", "", "right", "left", "long text", "long text");
+    TEST_FAST("[%s] [%8s] [%-8s]", nullText, nullText, nullText);
+    TEST_FAST("[%c] [%3c] [%-3c] [%c]", 'a', 'b', 'c', 0x141);
+    TEST_FAST("%s %d", longText.c_str(), 5);
+    TEST_FAST("%s%s%s", longText.c_str(), "", tailText.c_str());
+
+    // a long '%s' then fixed text and fields: the room of a later '%s' isn't past the 1KB buffer
+    TEST_FAST("%s%d%s", longText.c_str(), 5, tailText.c_str());
+    TEST_FAST("%s text %x %c%s", longText.c_str(), 0xfeed, 'c', tailText.c_str());
+
+    // -------------------
+    // PRINTF_TO_STACK: the buffer is sized by the bound of the fmt
+    // -------------------
+    static_assert(FMT_MAX_SIZE("%d %u %x \n") == 11 + 1 + 10 + 1 + 8 + 2, "failed for the bound of integers");
+    static_assert(FMT_MAX_SIZE("%.3s %5c%%") == 3 + 1 + 5 + 1,           "failed for the bound of '%.3s'");
+    static_assert(FMT_MAX_SIZE("%s") == FmtSizeUnbounded,                  "failed for '%s' without bound");
+    static_assert(FMT_MAX_SIZE("% d") == FmtSizeUnbounded,                 "failed for a '%' that isn't a field");
+    static_assert(FMT_MAX_SIZE("100%% %u") == 5 + 10,                      "failed for '%%'");
+
+    auto stackText = PRINTF_TO_STACK("stack: %d %.5s %08x", -123456789, "truncated", 0xbeefu);
+    printf("%s (%u of %zu)\n", stackText.c_str(), stackText.size, sizeof(stackText.buffer));
+
+    #ifdef ENABLE_FMT_VALIDATE
+    // -------------------
+    // validate(): an error past the 15 bits of a cached offset, the second call gives the same verdict
+    // -------------------
+    for(uint32_t errorOffset : { 100u, 40000u })
+    {
+        std::string longFmt = std::string(errorOffset, '.') + "%s\n";
+        auto        first   = printfcheck::validate<int>(longFmt.c_str());
+        auto        cached  = printfcheck::validate<int>(longFmt.c_str());
+
+        TEST_EXPECT(first.offset == errorOffset && cached.offset == first.offset && cached.error == first.error,
+                    "validate: offset %u, cached %u of %u\n", first.offset, cached.offset, errorOffset);
+    }
+
+    // -------------------
+    // getFmtArgDescs(): a letter per argument, the number of a '*' first
+    // -------------------
+    auto getArgKinds = [](const char* fmt)
+    {
+        std::string kinds;
+
+        for(const auto& arg : printfcheck::getFmtArgDescs(fmt))
+            kinds += arg.isPointerToNumber == true ? 'p' : arg.isCharArray == true ? 's' : arg.isFloatingPoint == true ? 'f' : 'n';
+
+        return kinds;
+    };
+
+    TEST_EXPECT(getArgKinds("%*d %s %n %5.2f %% %.*s %lu\n") == "nnspfnsn", "args: '%s'\n", getArgKinds("%*d %s %n %5.2f %% %.*s %lu\n").c_str());
+    TEST_EXPECT(getArgKinds("no field %%\n").empty() == true, "args: '%s' of no field\n", getArgKinds("no field %%\n").c_str());
+
+    // -------------------
+    // validateCatalog(): the failed indices, at the limits of the chunks, by 1 and N threads
+    // -------------------
+    {
+        constexpr size_t Size = 4 * printfcheck::FmtCatalogChunkSize + 10;
+
+        auto                                      args = printfcheck::getFmtArgDescs("user %s tried %d times\n");
+        std::vector<const char*>                  fmts(Size, "user %s tried %d times\n");
+        std::vector<printfcheck::FmtCatalogEntry> catalog(Size);
+
+        fmts[0]        = "user %d tried %d times\n";          // not a number
+        fmts[255]      = "user %s tried %s times\n";          // not a string
+        fmts[256]      = "user %s tried %d times %d\n";       // too few arguments
+        fmts[700]      = "user %s\n";                         // too many arguments: a warning
+        fmts[Size - 1] = "user %s tried %*d times\n";         // too few arguments
+
+        for(size_t i = 0; i < Size; i++) catalog[i] = { fmts[i], args.data(), (uint32_t)args.size() };
+
+        for(uint32_t threadCount : { 1u, 4u })
+        {
+            for(bool isWithWarnings : { false, true })
+            {
+                printfcheck::FmtCatalogReport report = printfcheck::validateCatalog(catalog.data(), catalog.size(), threadCount, isWithWarnings);
+
+                std::vector<uint32_t> indices;
+                size_t                invalids = 0;
+
+                for(const printfcheck::FmtCatalogError& error : report.errors)
+                {
+                    indices.push_back(error.index);
+                    invalids += error.result.isValid() == false ? 1 : 0;
+                }
+
+                std::vector<uint32_t> expected = isWithWarnings == true ? std::vector<uint32_t>({ 0, 255, 256, 700, Size - 1 })
+                                                                        : std::vector<uint32_t>({ 0, 255, 256, Size - 1 });
+
+                TEST_EXPECT(report.validated == Size && indices == expected && invalids == 4 && report.warnings == (isWithWarnings == true ? 1u : 0u),
+                            "catalog: %u threads, %zu errors, %zu invalid, %zu warnings of %zu\n",
+                            threadCount, report.errors.size(), invalids, report.warnings, report.validated);
+            }
+        }
+    }
+    #endif
+
+    #ifdef ENABLE_TRACE_DEFERRED
+    // the lines printed into a tmpfile by the deferred traces of 'send':
+    // by the consumer thread, or by the flush once they are sent
+    auto getTraceLines = [](bool isConsumerRunning, auto send)
+    {
+        FILE* traceFile = tmpfile();
+
+        printfcheck::startTraceConsumer(traceFile);
+        if (isConsumerRunning == false) printfcheck::stopTraceConsumer();
+
+        send();
+
+        // the rest into 'traceFile', then back to stdout
+        printfcheck::stopTraceConsumer();
+        printfcheck::startTraceConsumer(stdout);
+        printfcheck::stopTraceConsumer();
+
+        std::vector<std::string> lines;
+        char                     line[2048];
+
+        rewind(traceFile);
+        while(fgets(line, sizeof(line), traceFile) != nullptr) lines.push_back(line);
+        fclose(traceFile);
+
+        return lines;
+    };
+
+    // -------------------
+    // deferred traces: the text printed by flushTraces() is the one of snprintf()
+    // -------------------
+    {
+        std::vector<std::string> expected;
+        char                     line[2048];
+
+        (snprintf)(line, sizeof(line), "deferred: %d %u %x %c [%5s] %.3s %.*s %s\n", -1, 2u, 0xab, 'c', "str", "precision", 2, "star", nullText);
+        expected.push_back(line);
+        (snprintf)(line, sizeof(line), "deferred: %ld %llu %hhd %5.2f %e %%\n", -3L, ULLONG_MAX, 300, 1.5, 2.5);
+        expected.push_back(line);
+        (snprintf)(line, sizeof(line), "deferred: %s\n", longText.c_str());
+        expected.push_back(line);
+
+        auto lines = getTraceLines(false, [&]()
+        {
+            TRACEPRINT(1, LOG_DEBUG, "deferred: %d %u %x %c [%5s] %.3s %.*s %s\n", -1, 2u, 0xab, 'c', "str", "precision", 2, "star", nullText);
+            TRACEPRINT(1, LOG_DEBUG, "deferred: %ld %llu %hhd %5.2f %e %%\n", -3L, ULLONG_MAX, 300, 1.5, 2.5);
+            TRACEPRINT(1, LOG_DEBUG, "deferred: %s\n", longText.c_str());
+        });
+
+        TEST_EXPECT(lines == expected, "deferred: %zu lines, '%s'\n", lines.size(), lines.empty() ? "" : lines[0].c_str());
+    }
+
+    // -------------------
+    // deferred traces: in order per thread with the consumer running. With a
+    // full ring, also with -D TRACE_RING_SIZE=4096, every trace is printed or
+    // counted as dropped or overwritten: Drop keeps the oldest, Overwrite the newest
+    // -------------------
+    {
+        constexpr int Threads = 4;
+        constexpr int Calls   = 10000;
+
+        auto lines = getTraceLines(true, [&]()
+        {
+            std::vector<std::thread> producers;
+            for(int t = 0; t < Threads; t++)
+                producers.emplace_back([t]() { for(int i = 0; i < Calls; i++) TRACEPRINT(1, LOG_DEBUG, "thread %d trace %d\n", t, i); });
+            for(auto& producer : producers) producer.join();
+        });
+
+        int  next[Threads] = {};
+        bool isOrdered     = (lines.size() == Threads * Calls);
+
+        for(const std::string& line : lines)
+        {
+            int t = -1;
+            int i = -1;
+
+            if (sscanf(line.c_str(), "thread %d trace %d", &t, &i) != 2 || t < 0 || t >= Threads || i != next[t]++)
+                isOrdered = false;
+        }
+
+        TEST_EXPECT(isOrdered == true, "deferred: %zu traces of %d, not in order per thread\n", lines.size(), Threads * Calls);
+    }
+
+    for(printfcheck::TraceOverflow overflow : { printfcheck::TraceOverflow::Drop, printfcheck::TraceOverflow::Overwrite })
+    {
+        // 16 bytes a record at least: four rings, sent by a new thread with an empty ring
+        constexpr int Sent        = 4 * printfcheck::TraceRing::Capacity / 16;
+        uint64_t      dropped     = printfcheck::getDroppedTraces();
+        uint64_t      overwritten = printfcheck::getOverwrittenTraces();
+
+        printfcheck::setTraceOverflow(overflow);
+
+        auto lines = getTraceLines(false, [&]()
+        {
+            std::thread([]() { for(int i = 0; i < Sent; i++) TRACEPRINT(1, LOG_DEBUG, "full ring trace %d\n", i); }).join();
+        });
+
+        printfcheck::setTraceOverflow(printfcheck::TraceOverflow::Block);
+
+        bool     isDrop = (overflow == printfcheck::TraceOverflow::Drop);
+        uint64_t lost   = isDrop ? printfcheck::getDroppedTraces() - dropped : printfcheck::getOverwrittenTraces() - overwritten;
+        int      kept   = -1;
+
+        if (lines.empty() == false) sscanf((isDrop ? lines.front() : lines.back()).c_str(), "full ring trace %d", &kept);
+
+        TEST_EXPECT(lost > 0 && lines.size() + lost == Sent && kept == (isDrop ? 0 : Sent - 1),
+                    "deferred: %s %zu printed + %llu lost of %d, kept %d\n", isDrop ? "Drop" : "Overwrite",
+                    lines.size(), (unsigned long long)lost, Sent, kept);
+    }
+    #endif
+
+    #ifdef ENABLE_TRACE_SITES
+    // the lines printed on stdout by 'print', in a tmpfile
+    auto getStdoutLines = [](auto print)
+    {
+        FILE* capture = tmpfile();
+        int   saved   = dup(STDOUT_FILENO);
+
+        fflush(stdout);
+        dup2(fileno(capture), STDOUT_FILENO);
+        print();
+        fflush(stdout);
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+
+        std::vector<std::string> lines;
+        char                     line[256];
+
+        rewind(capture);
+        while(fgets(line, sizeof(line), capture) != nullptr) lines.push_back(line);
+        fclose(capture);
+
+        return lines;
+    };
+
+    auto countLines = [](const std::vector<std::string>& lines, const char* prefix)
+    {
+        return (int)std::count_if(lines.begin(), lines.end(), [prefix](const std::string& line) { return line.rfind(prefix, 0) == 0; });
+    };
+
+    // -------------------
+    // trace sites: switched off by file:line and by fmt, a rules file with an error changes nothing
+    // -------------------
+    {
+        constexpr int Calls    = 3;
+        constexpr int SiteLine = __LINE__ + 6;      // the line of "site by line"
+
+        auto printSites = []()
+        {
+            for(int i = 0; i < Calls; i++)
+            {
+                TRACEPRINT(1, LOG_DEBUG, "site by line %d\n", i);
+                TRACEPRINT(1, LOG_DEBUG, "site by fmt %d\n", i);
+                TRACEPRINT(1, LOG_DEBUG, "site on %d\n", i);
+            }
+        };
+
+        // "by line", "by fmt" and "on" printed by each configuration
+        auto getSiteCounts = [&]()
+        {
+            auto lines = getStdoutLines(printSites);
+            return std::vector<int>{ countLines(lines, "site by line"), countLines(lines, "site by fmt"), countLines(lines, "site on") };
+        };
+
+        auto writeRules = [](const char* path, const char* rules)
+        {
+            FILE* file = fopen(path, "w");
+            fputs(rules, file);
+            fclose(file);
+        };
+
+        char rulesPath[] = "/tmp/printfCheck_sitesXXXXXX";
+        close(mkstemp(rulesPath));
+
+        printfcheck::clearTraceSites();
+        auto allOn = getSiteCounts();
+
+        printfcheck::setTraceSite(std::string(__FILE__) + ":" + std::to_string(SiteLine), printfcheck::TraceSiteMode::Off);
+        printfcheck::setTraceSite("fmt:site by fmt", printfcheck::TraceSiteMode::Off);
+        auto switchedOff = getSiteCounts();
+
+        writeRules(rulesPath, "off fmt:site on\nsample ten fmt:site by line\n");
+        bool isWrongLoaded = printfcheck::loadTraceSites(rulesPath);
+        auto afterWrong    = getSiteCounts();
+
+        writeRules(rulesPath, "# the other sites are back on\noff     fmt:site on\n");
+        bool isLoaded  = printfcheck::loadTraceSites(rulesPath);
+        auto afterLoad = getSiteCounts();
+
+        printfcheck::clearTraceSites();
+        unlink(rulesPath);
+
+        TEST_EXPECT(allOn == std::vector<int>({ Calls, Calls, Calls }), "sites: %d %d %d on\n", allOn[0], allOn[1], allOn[2]);
+        TEST_EXPECT(switchedOff == std::vector<int>({ 0, 0, Calls }),
+                    "sites: %d %d %d switched off\n", switchedOff[0], switchedOff[1], switchedOff[2]);
+        TEST_EXPECT(isWrongLoaded == false && afterWrong == switchedOff,
+                    "sites: loaded %d, %d %d %d after a wrong file\n", isWrongLoaded, afterWrong[0], afterWrong[1], afterWrong[2]);
+        TEST_EXPECT(isLoaded == true && afterLoad == std::vector<int>({ Calls, Calls, 0 }),
+                    "sites: loaded %d, %d %d %d after a file\n", isLoaded, afterLoad[0], afterLoad[1], afterLoad[2]);
+    }
+
+    // -------------------
+    // trace sites: 'sample N' passes 1 in N calls, a rate limit its burst, reportTraceSites() counts the others
+    // -------------------
+    {
+        constexpr int Calls    = 100;
+        constexpr int Sampling = 10;
+        constexpr int Burst    = 4;
+
+        printfcheck::setTraceSiteSampling("fmt:site sampled", Sampling);
+        printfcheck::setTraceSiteRateLimit("fmt:site limited", 1, Burst);
+
+        auto lines = getStdoutLines([]()
+        {
+            for(int i = 0; i < Calls; i++)
+            {
+                TRACEPRINT(1, LOG_DEBUG, "site sampled %d\n", i);
+                TRACEPRINT(1, LOG_DEBUG, "site limited %d\n", i);
+            }
+        });
+
+        // the suppressed count reported for the site of 'fmt'
+        auto getReported = [](FILE* report, const char* fmt)
+        {
+            unsigned long long suppressed = 0;
+            char               line[256];
+
+            rewind(report);
+            while(fgets(line, sizeof(line), report) != nullptr)
+            {
+                if (strstr(line, fmt) != nullptr) sscanf(line, "printfcheck: %llu traces suppressed", &suppressed);
+            }
+
+            return (int)suppressed;
+        };
+
+        FILE* report = tmpfile();
+        printfcheck::reportTraceSites(report);
+        int sampledReport = getReported(report, "\"site sampled");
+        int limitedReport = getReported(report, "\"site limited");
+        fclose(report);
+
+        // nothing was suppressed since
+        report = tmpfile();
+        printfcheck::reportTraceSites(report);
+        long secondReport = (fseek(report, 0, SEEK_END), ftell(report));
+        fclose(report);
+
+        printfcheck::clearTraceSites();
+
+        int sampled = countLines(lines, "site sampled");
+        int limited = countLines(lines, "site limited");
+
+        TEST_EXPECT(sampled == Calls / Sampling, "sites: %d of %d sampled calls printed\n", sampled, Calls);
+        TEST_EXPECT(sampledReport == Calls - sampled, "sites: %d sampled calls reported suppressed\n", sampledReport);
+        TEST_EXPECT(limited == Burst, "sites: %d of %d limited calls printed\n", limited, Calls);
+        TEST_EXPECT(limitedReport == Calls - limited, "sites: %d limited calls reported suppressed\n", limitedReport);
+        TEST_EXPECT(secondReport == 0, "sites: %ld bytes in the second report\n", secondReport);
+    }
+    #endif
+
+    #ifdef ENABLE_PRINTF_PROFILE
+    // -------------------
+    // profile: the calls and the bytes of each site, of a thread running and of one exited
+    // -------------------
+    {
+        constexpr int Calls = 10;       // i in 0..9: every line is as long
+
+        char buffer[64];
+        for(int i = 0; i < Calls; i++) snprintf(buffer, sizeof(buffer), "profile buffer %d\n", i);
+
+        FILE* file = tmpfile();
+        std::thread([file]()
+        {
+            for(int i = 0; i < Calls; i++) fprintf(file, "profile thread %d\n", i);
+        }).join();
+        fclose(file);
+
+        auto getEntry = [](const char* fmt)
+        {
+            for(const printfcheck::PrintfProfileEntry& entry : printfcheck::getPrintfProfile())
+            {
+                if (strcmp(entry.site->fmt, fmt) == 0) return entry;
+            }
+
+            return printfcheck::PrintfProfileEntry();
+        };
+
+        auto bufferEntry = getEntry("profile buffer %d\n");
+        auto threadEntry = getEntry("profile thread %d\n");
+
+        TEST_EXPECT(bufferEntry.calls == Calls && bufferEntry.bytes == Calls * strlen("profile buffer 0\n"),
+                    "profile: %llu calls, %llu bytes\n", (unsigned long long)bufferEntry.calls, (unsigned long long)bufferEntry.bytes);
+        TEST_EXPECT(threadEntry.calls == Calls && threadEntry.bytes == Calls * strlen("profile thread 0\n"),
+                    "profile: %llu calls, %llu bytes of a thread exited\n", (unsigned long long)threadEntry.calls, (unsigned long long)threadEntry.bytes);
+
+        // the exited thread is counted once, by the reports after
+        threadEntry = getEntry("profile thread %d\n");
+        TEST_EXPECT(threadEntry.calls == Calls, "profile: %llu calls of a thread exited, reported again\n", (unsigned long long)threadEntry.calls);
+
+        #ifdef ENABLE_PRINTF_LATENCY
+        // an entry per site that ran, its percentiles in order
+        int latencySites = 0;
+
+        for(const printfcheck::PrintfLatencyEntry& entry : printfcheck::getPrintfLatencies())
+        {
+            if (strcmp(entry.site->fmt, "profile buffer %d\n") != 0 && strcmp(entry.site->fmt, "profile thread %d\n") != 0) continue;
+
+            latencySites++;
+            TEST_EXPECT(entry.calls == Calls && entry.p50 <= entry.p99 && entry.p99 <= entry.p999 && entry.p999 <= entry.max,
+                        "latency: %llu calls, %.0f %.0f %.0f %.0f ns\n", (unsigned long long)entry.calls, entry.p50, entry.p99, entry.p999, entry.max);
+        }
+
+        TEST_EXPECT(latencySites == 2, "latency: %d of 2 sites\n", latencySites);
+        TEST_EXPECT(printfcheck::getPrintfLatencies().size() == printfcheck::getPrintfProfile().size(), "latency: not a site per profile site\n");
+        #endif
+    }
+    #endif
+
+    // -------------------
+    // constant calls: with ENABLE_PRINTF_CONST an fwrite() of the output, formatted at compile-time
+    // -------------------
+    constexpr int BuildMinor = 7;
+    printf("const: build %s %d.%02d %-5s| %x\n", "printfCheck", 1, BuildMinor, "rel", 0xC0DEu);
+    PRINTF_FAST("const: fast %c%c %5d\n", 'o', 'k', -BuildMinor);
 
     #endif // FMT_DEBUG_ALL
 
-    return 0;
+    #if FMT_BENCH_FAST == 1
+    {
+        // per-call time of snprintf() and SNPRINTF_FAST()
+        constexpr int Calls = 1000000;
+        char          line[128];
+        const char*   name = "worker";
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+            snprintf(line, sizeof(line), "[%s] request %d took %u us, status %x\n", name, i, (unsigned)i * 3, i & 0xFFF);
+        auto middle = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+            SNPRINTF_FAST(line, sizeof(line), "[%s] request %d took %u us, status %x\n", name, i, (unsigned)i * 3, i & 0xFFF);
+        auto end = std::chrono::steady_clock::now();
+
+        double printfNs = std::chrono::duration<double, std::nano>(middle - start).count() / Calls;
+        double fastNs   = std::chrono::duration<double, std::nano>(end - middle).count()   / Calls;
+        printf("bench: snprintf() %.1f ns, SNPRINTF_FAST() %.1f ns\n", printfNs, fastNs);
+    }
+    #endif // FMT_BENCH_FAST
+
+    #if FMT_BENCH_TRACE == 1 && defined(ENABLE_TRACE_DEFERRED)
+    {
+        // traces per second from 1 to 64 threads: fprintf() against the rings
+        constexpr int Calls = 20000;     // per thread
+        FILE*         null  = fopen("/dev/null", "w");
+
+        printfcheck::startTraceConsumer(null);
+        printf("bench: threads   fprintf[Mt/s]   Block[Mt/s]   Drop[Mt/s]  dropped   Overwrite[Mt/s]  overwritten\n");
+
+        for(int threads = 1; threads <= 64; threads *= 2)
+        {
+            double   rates[4]   = {};
+            uint64_t dropped    = printfcheck::getDroppedTraces();
+            uint64_t overwritten = printfcheck::getOverwrittenTraces();
+
+            for(int mode = 0; mode < 4; mode++)
+            {
+                if (mode > 0) printfcheck::setTraceOverflow((printfcheck::TraceOverflow)(mode - 1));
+
+                auto start = std::chrono::steady_clock::now();
+
+                std::vector<std::thread> producers;
+                for(int t = 0; t < threads; t++)
+                {
+                    producers.emplace_back([mode, null, t]()
+                    {
+                        for(int i = 0; i < Calls; i++)
+                        {
+                            if (mode == 0) fprintf(null, "thread %d trace %d: %s\n", t, i, "payload");
+                            else           TRACEPRINT(1, LOG_DEBUG, "thread %d trace %d: %s\n", t, i, "payload");
+                        }
+                    });
+                }
+                for(auto& producer : producers) producer.join();
+
+                printfcheck::flushTraces();
+                auto end = std::chrono::steady_clock::now();
+
+                rates[mode] = (double)threads * Calls / std::chrono::duration<double, std::micro>(end - start).count();
+            }
+
+            printf("bench: %7d %15.2f %13.2f %12.2f %8lu %17.2f %12lu\n", threads, rates[0], rates[1], rates[2],
+                   (unsigned long)(printfcheck::getDroppedTraces() - dropped), rates[3],
+                   (unsigned long)(printfcheck::getOverwrittenTraces() - overwritten));
+        }
+
+        printfcheck::stopTraceConsumer();
+        printfcheck::setTraceOverflow(printfcheck::TraceOverflow::Block);
+        fclose(null);
+    }
+    #endif // FMT_BENCH_TRACE
+
+    #if FMT_BENCH_SITES == 1 && defined(ENABLE_TRACE_SITES)
+    {
+        // per-call time of a disabled TRACEPRINT() in a tight loop
+        constexpr int Calls = 100000000;
+        volatile int  sink  = 0;
+
+        // a site switched off, a site whose level is off, a sampled site and a limited site
+        printfcheck::setTraceSite("fmt:bench site", printfcheck::TraceSiteMode::Off);
+        printfcheck::setTraceLevel(LOG_DEBUG - 1);
+        printfcheck::setTraceSiteSampling("fmt:bench sampled", 50000000);
+        printfcheck::setTraceSiteRateLimit("fmt:bench limited", 1);
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+            sink = i;
+        auto middle = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+        {
+            sink = i;
+            TRACEPRINT(1, 1, "bench site off %d %s\n", i, "payload");
+        }
+        auto level = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+        {
+            sink = i;
+            TRACEPRINT(1, LOG_DEBUG, "bench level off %d %s\n", i, "payload");
+        }
+        auto sampled = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+        {
+            sink = i;
+            TRACEPRINT(1, 1, "bench sampled %d %s\n", i, "payload");
+        }
+        auto limited = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+        {
+            sink = i;
+            TRACEPRINT(1, 1, "bench limited %d %s\n", i, "payload");
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        printfcheck::reportTraceSites(stdout);
+        printfcheck::setTraceLevel(INT32_MAX);
+        printfcheck::clearTraceSites();
+        (void)sink;
+
+        double loopNs    = std::chrono::duration<double, std::nano>(middle - start).count()    / Calls;
+        double siteNs    = std::chrono::duration<double, std::nano>(level - middle).count()    / Calls - loopNs;
+        double levelNs   = std::chrono::duration<double, std::nano>(sampled - level).count()   / Calls - loopNs;
+        double sampledNs = std::chrono::duration<double, std::nano>(limited - sampled).count() / Calls - loopNs;
+        double limitedNs = std::chrono::duration<double, std::nano>(end - limited).count()     / Calls - loopNs;
+        printf("bench: loop %.2f ns, site off +%.2f ns, level off +%.2f ns, sampled +%.2f ns, limited +%.2f ns\n",
+               loopNs, siteNs, levelNs, sampledNs, limitedNs);
+    }
+    #endif // FMT_BENCH_SITES
+
+    #if FMT_BENCH_PROFILE == 1 && defined(ENABLE_PRINTF_PROFILE)
+    {
+        // per-call cost of the counters: snprintf() counted, against (snprintf) that isn't
+        constexpr int Calls = 10000000;
+        char          buffer[64];
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+            (snprintf)(buffer, sizeof(buffer), "bench profile %d\n", i);
+        auto middle = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+            snprintf(buffer, sizeof(buffer), "bench profile %d\n", i);
+        auto end = std::chrono::steady_clock::now();
+
+        // the same sites from several threads
+        std::vector<std::thread> threads;
+        for(int t = 0; t < 4; t++)
+            threads.emplace_back([]()
+            {
+                char text[64];
+                for(int i = 0; i < Calls; i++)
+                {
+                    if (i % 16 == 0) snprintf(text, sizeof(text), "bench thread rare %d\n", i);
+                    else             snprintf(text, sizeof(text), "bench thread %d\n", i);
+                }
+            });
+        for(auto& thread : threads) thread.join();
+
+        double plainNs   = std::chrono::duration<double, std::nano>(middle - start).count() / Calls;
+        double countedNs = std::chrono::duration<double, std::nano>(end - middle).count()   / Calls;
+        printf("bench: snprintf %.2f ns, counted %.2f ns\n", plainNs, countedNs);
+
+        printfcheck::dumpPrintfProfile(stdout, 5);
+        #ifdef ENABLE_PRINTF_LATENCY
+        printfcheck::dumpPrintfLatencies(stdout, 5);
+        #endif
+    }
+    #endif // FMT_BENCH_PROFILE
+
+    #if FMT_BENCH_VALIDATE == 1 && defined(ENABLE_FMT_VALIDATE)
+    {
+        // a fmt from a table: validated once, then found in the cache
+        constexpr int Calls = 10000000;
+        static const char* const Table[] = { "user %s logged in from %s after %d attempts, session %08x, %lu bytes\n" };
+        volatile uint32_t sink = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+            sink = printfcheck::validateFmt(Table[0], FmtArgTable<FmtTypeList<const char*, const char*, int, unsigned, unsigned long>>::value.data(), 5).argCounter;
+        auto middle = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++)
+            sink = printfcheck::validate<const char*, const char*, int, unsigned, unsigned long>(Table[0]).argCounter;
+        auto end = std::chrono::steady_clock::now();
+        (void)sink;
+
+        auto verdict = printfcheck::validate<const char*, int>(Table[0]);
+        printf("bench: validate %.2f ns, cached %.2f ns, wrong types: valid %d error %d at %u\n",
+               std::chrono::duration<double, std::nano>(middle - start).count() / Calls,
+               std::chrono::duration<double, std::nano>(end - middle).count() / Calls,
+               verdict.isValid(), (int)verdict.error, verdict.offset);
+
+        // a catalog of 1M fmts checked against the arguments of the original fmt, a bad one every 100K
+        constexpr size_t CatalogSize = 1000000;
+        std::vector<FmtArgDesc> args = printfcheck::getFmtArgDescs(Table[0]);
+        std::vector<std::string> texts(CatalogSize, Table[0]);
+        std::vector<printfcheck::FmtCatalogEntry> catalog(CatalogSize);
+
+        for(size_t i = 0; i < CatalogSize; i += 100000) texts[i] = "user %d logged in\n";
+        for(size_t i = 0; i < CatalogSize; i++)         catalog[i] = { texts[i].c_str(), args.data(), (uint32_t)args.size() };
+
+        auto catalogStart = std::chrono::steady_clock::now();
+        printfcheck::FmtCatalogReport report = printfcheck::validateCatalog(catalog.data(), catalog.size());
+        auto catalogEnd = std::chrono::steady_clock::now();
+
+        printf("bench: catalog of %zu fmts in %.1f ms with %u threads, %zu errors\n", report.validated,
+               std::chrono::duration<double, std::milli>(catalogEnd - catalogStart).count(),
+               std::thread::hardware_concurrency(), report.errors.size());
+    }
+    #endif // FMT_BENCH_VALIDATE
+
+    #if FMT_BENCH_STRING == 1 && defined(ENABLE_PRINTF_STRING)
+    {
+        // a std::string_view, copied to a std::string for c_str(), then as "%.*s"
+        constexpr int    Calls = 10000000;
+        char             line[256];
+        std::string      path(160, 'p');
+        std::string_view name = std::string_view(path).substr(100, 40);
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++) snprintf(line, sizeof(line), "open %s as %d", std::string(name).c_str(), i);
+        auto middle = std::chrono::steady_clock::now();
+        for(int i = 0; i < Calls; i++) snprintf(line, sizeof(line), "open %s as %d", name, i);
+        auto end = std::chrono::steady_clock::now();
+
+        printf("bench: copy %.2f ns, view %.2f ns, %s\n",
+               std::chrono::duration<double, std::nano>(middle - start).count() / Calls,
+               std::chrono::duration<double, std::nano>(end - middle).count() / Calls, line);
+    }
+    #endif // FMT_BENCH_STRING
+
+    #ifdef ENABLE_TRACE_DEFERRED
+    printfcheck::stopTraceConsumer();
+    #endif
+
+    return testFailures == 0 ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,875 @@
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2019 - 2024 Aitor Folgoso <aitor.folgoso@gmail.com>.
+
+/** *************************** **/
+/** FILE: printfCheck_scan.cpp  **/
+/** *************************** **/
+
+/** *********************************************************************************
+//  printfcheck-scan: checks the printf() calls of a source tree without
+//  compiling it. A lexer finds the calls of printf(), fprintf(),
+//  sprintf(), snprintf(), TRACEPRINT(), the *_FAST() macros and the
+//  macros given with -m, and their fmt literal is checked by
+//  printfcheck::validateFmt(), the rules of PRINTF_CHECK() at runtime.
+//  The argument types are only known for literals, casts and a few
+//  expressions, the others match any field: the counts are always
+//  checked, the types when they are known.
+//
+//  g++ -std=c++17 -O2 -pthread printfCheck_scan.cpp -o printfcheck-scan
+//
+//  printfcheck-scan [-j threads] [-m MACRO:fmtIndex]... [--cache file] [--warnings] paths...
+//
+//  the directories are scanned for C and C++ sources. With --cache the
+//  content hashes of the files without findings are kept in 'file',
+//  the next run skips them while they don't change. The lexer skips
+//  the comments, the literals, the directives and the '#if 0' blocks,
+//  the other conditionals aren't evaluated
+*********************************************************************************** **/
+#define ENABLE_FMT_VALIDATE
+#include "printfCheck.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace printfcheck;
+
+/** *****************************
+//  MappedFile
+//  read-only mmap of a whole file, an empty file has no mapping
+****************************** **/
+struct MappedFile
+{
+    const char* data = nullptr;
+    size_t      size = 0;
+    bool        isMapped = false;
+
+    bool open(const char* path)
+    {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st = {};
+        bool isRead = fstat(fd, &st) == 0;
+
+        if (isRead == true && st.st_size > 0)
+        {
+            void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            isRead = map != MAP_FAILED;
+
+            if (isRead == true)
+            {
+                data     = (const char*)map;
+                size     = (size_t)st.st_size;
+                isMapped = true;
+                madvise(map, size, MADV_SEQUENTIAL);
+            }
+        }
+
+        close(fd);
+        return isRead;
+    }
+
+    ~MappedFile()
+    {
+        if (isMapped == true) munmap((void*)data, size);
+    }
+};
+
+/** *****************************
+//  hashScanFile()
+//  FNV-1a on 64-bit words, for the cache: it's only compared with the
+//  hashes of the previous runs
+****************************** **/
+uint64_t
+hashScanFile(const char* data, size_t size)
+{
+    uint64_t hash = FmtHashOffset ^ size;
+    size_t   i    = 0;
+
+    for(; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * FmtHashPrime;
+    }
+
+    return hashFmtFnv1a(std::string_view(data + i, size - i), hash);
+}
+
+/** *****************************
+//  the lexer
+//  each function starts at the first character of what it skips and
+//  returns the character after it, 'line' follows the new lines
+****************************** **/
+using ScanCallees = std::unordered_map<std::string_view, uint32_t>;    // the index of the fmt argument
+
+struct ScanFinding
+{
+    uint32_t    line    = 0;
+    bool        isError = true;
+    std::string text;
+};
+
+constexpr bool isScanIdentifierStart(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+constexpr bool isScanIdentifier(char c)      { return isScanIdentifierStart(c) == true || (c >= '0' && c <= '9'); }
+constexpr bool isScanSpace(char c)           { return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+
+const char*
+skipScanComment(const char* p, const char* end, uint32_t& line)
+{
+    if (p + 1 >= end || p[0] != '/') return p;
+
+    if (p[1] == '/')
+    {
+        // a '\' at the end of the line continues the comment
+        for(p += 2; p < end && *p != '\n'; p++)
+            if (*p == '\\' && p + 1 < end && p[1] == '\n') { p++; line++; }
+        return p;
+    }
+
+    if (p[1] == '*')
+    {
+        for(p += 2; p + 1 < end && (p[0] != '*' || p[1] != '/'); p++)
+            if (*p == '\n') line++;
+        return std::min(p + 2, end);
+    }
+
+    return p;
+}
+
+// "..." or '...'
+const char*
+skipScanLiteral(const char* p, const char* end, uint32_t& line)
+{
+    char quote = *p++;
+
+    for(; p < end && *p != quote; p++)
+    {
+        if (*p == '\\' && p + 1 < end) { p++; if (*p == '\n') line++; }
+        else if (*p == '\n')           { line++; break; }      // not closed
+    }
+
+    return std::min(p + 1, end);
+}
+
+// R"delimiter( ... )delimiter", p at the '"'
+const char*
+skipScanRawLiteral(const char* p, const char* end, uint32_t& line)
+{
+    const char* open = (const char*)memchr(p, '(', (size_t)(end - p));
+    if (open == nullptr || open - p > 17) return skipScanLiteral(p, end, line);
+
+    std::string closing = ")" + std::string(p + 1, open) + "\"";
+
+    for(p = open + 1; p < end; p++)
+    {
+        if (*p == '\n') line++;
+        if (*p == ')' && (size_t)(end - p) >= closing.size() && memcmp(p, closing.data(), closing.size()) == 0)
+            return p + closing.size();
+    }
+
+    return end;
+}
+
+constexpr
+bool
+isScanRawPrefix(std::string_view prefix)
+{
+    return prefix == "R" || prefix == "u8R" || prefix == "LR" || prefix == "uR" || prefix == "UR";
+}
+
+const char*
+skipScanSpaces(const char* p, const char* end, uint32_t& line)
+{
+    while(p < end)
+    {
+        if      (isScanSpace(*p) == true)                                      p++;
+        else if (*p == '\n')                                                   { line++; p++; }
+        else if (*p == '/' && p + 1 < end && (p[1] == '/' || p[1] == '*'))     p = skipScanComment(p, end, line);
+        else                                                                   break;
+    }
+
+    return p;
+}
+
+// the rest of a directive line, with its continuations and comments
+const char*
+skipScanLine(const char* p, const char* end, uint32_t& line)
+{
+    while(p < end && *p != '\n')
+    {
+        if      (*p == '\\' && p + 1 < end && p[1] == '\n')                    { p += 2; line++; }
+        else if (*p == '\\' && p + 2 < end && p[1] == '\r' && p[2] == '\n')    { p += 3; line++; }
+        else if (*p == '/' && p + 1 < end && (p[1] == '/' || p[1] == '*'))     p = skipScanComment(p, end, line);
+        else if (*p == '"' || *p == '\'')                                      p = skipScanLiteral(p, end, line);
+        else                                                                   p++;
+    }
+
+    return p;
+}
+
+// the directive word after '#': "if", "endif"...
+std::string_view
+getScanDirective(const char* p, const char* end)
+{
+    for(p++; p < end && isScanSpace(*p) == true; p++) {}
+
+    const char* start = p;
+    while(p < end && isScanIdentifier(*p) == true) p++;
+
+    return std::string_view(start, (size_t)(p - start));
+}
+
+// a directive, p at the '#'. '#if 0' skips its block up to its #else, #elif or #endif
+const char*
+skipScanDirective(const char* p, const char* end, uint32_t& line)
+{
+    std::string_view directive = getScanDirective(p, end);
+    const char*      text      = directive.data() + directive.size();
+
+    for(; text < end && isScanSpace(*text) == true; text++) {}
+
+    bool isIfZero = directive == "if" && text < end && *text == '0' && (text + 1 == end || isScanIdentifier(text[1]) == false);
+
+    p = skipScanLine(p, end, line);
+    if (isIfZero == false) return p;
+
+    for(uint32_t depth = 0; p < end; )
+    {
+        p++;    // '\n'
+        line++;
+
+        const char* start = p;
+        while(p < end && isScanSpace(*p) == true) p++;
+
+        if (p < end && *p == '#')
+        {
+            directive = getScanDirective(p, end);
+
+            if      (directive.substr(0, 2) == "if")                       depth++;
+            else if (directive == "endif" && depth > 0)                    depth--;
+            else if (directive == "endif" || directive == "else" ||
+                     directive == "elif"  || directive == "elifdef" ||
+                     directive == "elifndef")                              return depth == 0 ? skipScanLine(p, end, line) : start;
+        }
+
+        p = skipScanLine(p, end, line);
+    }
+
+    return p;
+}
+
+/** *****************************
+//  decodeScanFmt()
+//  the fmt argument: only adjacent "..." literals, the escapes are
+//  decoded. false for anything else: a variable, a macro, L"..."
+****************************** **/
+bool
+decodeScanFmt(std::string_view text, std::string& fmt)
+{
+    const char* p   = text.data();
+    const char* end = p + text.size();
+    uint32_t    line = 0;
+    bool        isLiteral = false;
+
+    fmt.clear();
+
+    while((p = skipScanSpaces(p, end, line)) < end)
+    {
+        if (end - p >= 2 && p[0] == 'u' && p[1] == '8') p += 2;
+
+        if (*p == 'R' && p + 1 < end && p[1] == '"')
+        {
+            const char* literalEnd = skipScanRawLiteral(p + 1, end, line);
+            const char* open       = (const char*)memchr(p, '(', (size_t)(literalEnd - p));
+            const char* close      = literalEnd - (open - p);     // ')' + delimiter + '"'
+
+            if (open == nullptr || close < open) return false;
+            fmt.append(open + 1, close);
+            p = literalEnd;
+            isLiteral = true;
+            continue;
+        }
+
+        if (*p != '"') return false;
+
+        for(p++; p < end && *p != '"'; p++)
+        {
+            if (*p != '\\' || p + 1 >= end)
+            {
+                fmt += *p;
+                continue;
+            }
+
+            char c = *++p;
+            if      (c == 'n') fmt += '\n';
+            else if (c == 't') fmt += '\t';
+            else if (c == 'r') fmt += '\r';
+            else if (c == 'a') fmt += '\a';
+            else if (c == 'b') fmt += '\b';
+            else if (c == 'f') fmt += '\f';
+            else if (c == 'v') fmt += '\v';
+            else if (c == 'x')
+            {
+                uint32_t value = 0;
+                for(; p + 1 < end && isxdigit((unsigned char)p[1]) != 0; p++)
+                {
+                    char digit = (char)tolower((unsigned char)p[1]);
+                    value = value * 16 + (uint32_t)(digit <= '9' ? digit - '0' : digit - 'a' + 10);
+                }
+                fmt += (char)value;
+            }
+            else if (c >= '0' && c <= '7')
+            {
+                uint32_t value = (uint32_t)(c - '0');
+                for(int i = 0; i < 2 && p + 1 < end && p[1] >= '0' && p[1] <= '7'; i++) value = value * 8 + (uint32_t)(*++p - '0');
+                fmt += (char)value;
+            }
+            else if (c == '\n') {}
+            else               fmt += c;
+        }
+
+        p = std::min(p + 1, end);
+        isLiteral = true;
+    }
+
+    // printf() stops at a '\0'
+    fmt.resize(strlen(fmt.c_str()));
+    return isLiteral;
+}
+
+/** *****************************
+//  makeScanArgDesc()
+//  the type of an argument from its text: literals, casts, sizeof,
+//  .size() and .c_str(). An unknown type matches every field
+****************************** **/
+FmtArgDesc
+makeScanTypeDesc(std::string_view type)
+{
+    static const std::unordered_set<std::string_view> NumberWords = {
+        "char", "short", "int", "long", "signed", "unsigned", "bool", "float", "double",
+        "size_t", "ssize_t", "ptrdiff_t", "intptr_t", "uintptr_t", "intmax_t", "uintmax_t", "off_t",
+        "int8_t", "int16_t", "int32_t", "int64_t", "uint8_t", "uint16_t", "uint32_t", "uint64_t",
+        "const", "volatile", "std" };
+
+    FmtArgDesc desc      = {};
+    bool       isPointer = type.find('*') != std::string_view::npos;
+    bool       isChar    = false;
+    bool       isFloat   = false;
+
+    // every word is a known number type
+    for(size_t i = 0; i < type.size(); )
+    {
+        if (isScanIdentifierStart(type[i]) == false)
+        {
+            if (type[i] != '*' && type[i] != ':' && isScanSpace(type[i]) == false) return FmtArgDesc{ true, true, true, true };
+            i++;
+            continue;
+        }
+
+        size_t start = i;
+        while(i < type.size() && isScanIdentifier(type[i]) == true) i++;
+
+        std::string_view word = type.substr(start, i - start);
+        if (NumberWords.count(word) == 0) return FmtArgDesc{ true, true, true, true };
+
+        isChar  |= word == "char";
+        isFloat |= word == "float" || word == "double";
+    }
+
+    if (isPointer == true)
+    {
+        desc.isCharArray       = isChar;
+        desc.isPointerToNumber = true;
+    }
+    else
+    {
+        desc.isNumber        = true;
+        desc.isFloatingPoint = isFloat;
+    }
+
+    return desc;
+}
+
+// after a cast: an operand without binary operators, "->" apart
+constexpr
+bool
+isScanPrimary(std::string_view text)
+{
+    for(size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+
+        if (c == '-' && i + 1 < text.size() && text[i + 1] == '>') { i++; continue; }
+        if (std::string_view("+-*/%&|^<>?=!,~\"'").find(c) != std::string_view::npos) return false;
+    }
+
+    return text.empty() == false;
+}
+
+FmtArgDesc
+makeScanArgDesc(std::string_view text)
+{
+    const FmtArgDesc Unknown = { true, true, true, true };
+
+    while(text.empty() == false && isScanSpace(text.front()) == true) text.remove_prefix(1);
+    while(text.empty() == false && (isScanSpace(text.back()) == true || text.back() == '\n')) text.remove_suffix(1);
+
+    if (text.empty() == true) return Unknown;
+
+    FmtArgDesc desc = {};
+
+    // "...", u8"..."
+    if (text.front() == '"' || text.substr(0, 3) == "u8\"")
+    {
+        desc.isCharArray = true;
+        return desc;
+    }
+
+    // 'c', the number of a character
+    if (text.front() == '\'' && text.back() == '\'')
+    {
+        desc.isNumber = true;
+        return desc;
+    }
+
+    if (text == "true" || text == "false")
+    {
+        desc.isNumber = true;
+        return desc;
+    }
+
+    // a number literal, signed
+    std::string_view number = text;
+    if (number.front() == '-' || number.front() == '+') number.remove_prefix(1);
+
+    if (number.empty() == false && (isdigit((unsigned char)number.front()) != 0 || (number.front() == '.' && number.size() > 1)))
+    {
+        bool isHex = number.size() > 1 && number[0] == '0' && (number[1] == 'x' || number[1] == 'X');
+
+        for(char c : number)
+            if (isScanIdentifier(c) == false && c != '.' && c != '\'' && c != '+' && c != '-') return Unknown;
+
+        desc.isNumber        = true;
+        desc.isFloatingPoint = number.find('.') != std::string_view::npos ||
+                               (isHex == false && number.find_first_of("eE") != std::string_view::npos) ||
+                               (isHex == true  && number.find_first_of("pP") != std::string_view::npos);
+        return desc;
+    }
+
+    if (text.substr(0, 6) == "sizeof" && (text.size() == 6 || isScanIdentifier(text[6]) == false))
+    {
+        desc.isNumber = true;
+        return desc;
+    }
+
+    // x.c_str(), x.size(), x.length()
+    if (isScanPrimary(text) == true)
+    {
+        if (text.size() > 8 && text.substr(text.size() - 8) == ".c_str()")
+        {
+            desc.isCharArray = true;
+            return desc;
+        }
+
+        if ((text.size() > 7 && text.substr(text.size() - 7) == ".size()") ||
+            (text.size() > 9 && text.substr(text.size() - 9) == ".length()"))
+        {
+            desc.isNumber = true;
+            return desc;
+        }
+    }
+
+    // (type)operand
+    if (text.front() == '(')
+    {
+        size_t close = text.find(')');
+
+        if (close != std::string_view::npos && isScanPrimary(text.substr(close + 1)) == true)
+            return makeScanTypeDesc(text.substr(1, close - 1));
+    }
+
+    // static_cast<type>(operand)
+    if (text.substr(0, 12) == "static_cast<")
+    {
+        size_t close = text.find('>');
+
+        if (close != std::string_view::npos && close + 1 < text.size() && text[close + 1] == '(' && text.back() == ')')
+            return makeScanTypeDesc(text.substr(12, close - 12));
+    }
+
+    return Unknown;
+}
+
+/** *****************************
+//  scanCall()
+//  the arguments of a call, p at its '('. The commas of the nested
+//  parentheses, brackets, braces and literals don't split them
+****************************** **/
+void
+scanCall(const char* p, const char* end, uint32_t line, std::string_view name, uint32_t fmtIndex, bool isWithWarnings,
+         std::vector<ScanFinding>& findings)
+{
+    std::vector<std::string_view> args;
+    const char*                   start = ++p;
+    uint32_t                      depth = 0;
+
+    while(p < end)
+    {
+        char c = *p;
+
+        if      (c == '"' || c == '\'')                                        { p = skipScanLiteral(p, end, line); continue; }
+        else if (c == '/' && p + 1 < end && (p[1] == '/' || p[1] == '*'))      { p = skipScanComment(p, end, line); continue; }
+        else if (c == '(' || c == '[' || c == '{')                             depth++;
+        else if ((c == ')' || c == ']' || c == '}') && depth > 0)              depth--;
+        else if (c == ')' || c == ']' || c == '}')                             break;
+        else if (c == ',' && depth == 0)
+        {
+            args.push_back(std::string_view(start, (size_t)(p - start)));
+            start = p + 1;
+        }
+        else if (c == 'R' && p + 1 < end && p[1] == '"' && (p == start || isScanIdentifier(p[-1]) == false))
+        {
+            p = skipScanRawLiteral(p + 1, end, line);
+            continue;
+        }
+
+        p++;
+    }
+
+    if (p >= end || *p != ')') return;
+
+    std::string_view last(start, (size_t)(p - start));
+    if (args.empty() == false || last.find_first_not_of(" \t\r\n") != std::string_view::npos) args.push_back(last);
+
+    std::string fmt;
+    if (fmtIndex >= args.size() || decodeScanFmt(args[fmtIndex], fmt) == false) return;
+
+    std::vector<FmtArgDesc> descs;
+    for(size_t i = fmtIndex + 1; i < args.size(); i++) descs.push_back(makeScanArgDesc(args[i]));
+
+    FmtValidation result  = validateFmt(fmt.c_str(), descs.data(), (uint32_t)descs.size());
+    bool          isError = result.isValid() == false;
+
+    if (isError == false && (isWithWarnings == false || result.hasWarnings() == false)) return;
+
+    const char* text = result.argCounter > result.argsSize ? "too few arguments"  :
+                       isError == true                     ? getFmtErrorText(result.error) :
+                       result.argsSize > result.argCounter ? "too many arguments" :
+                       result.error != FmtError::NoError   ? getFmtErrorText(result.error) : getFmtErrorText(result.warning);
+
+    std::string_view literal = args[fmtIndex];
+    while(literal.empty() == false && (isScanSpace(literal.front()) == true || literal.front() == '\n')) literal.remove_prefix(1);
+
+    ScanFinding finding;
+    finding.line    = line;
+    finding.isError = isError;
+    finding.text    = std::string(isError == true ? "error: " : "warning: ") + text + ": " + std::string(name) + "(" +
+                      std::string(literal.substr(0, std::min<size_t>(literal.find('\n'), 80))) + ")";
+
+    findings.push_back(std::move(finding));
+}
+
+/** *****************************
+//  scanSource()
+//  the calls of a file: an identifier of 'callees' followed by '(',
+//  not a member ('.', '->') nor parenthesized like '(printf)(...)'
+****************************** **/
+void
+scanSource(const char* data, size_t size, const ScanCallees& callees, bool isWithWarnings, std::vector<ScanFinding>& findings)
+{
+    const char* p           = data;
+    const char* end         = data + size;
+    uint32_t    line        = 1;
+    bool        isLineStart = true;
+    char        previous[2] = {};      // the last two significant characters
+
+    while(p < end)
+    {
+        char c = *p;
+
+        if (c == '\n')                                              { line++; p++; isLineStart = true; continue; }
+        if (isScanSpace(c) == true)                                 { p++; continue; }
+        if (c == '#' && isLineStart == true)                        { p = skipScanDirective(p, end, line); continue; }
+        if (c == '/' && p + 1 < end && (p[1] == '/' || p[1] == '*')) { p = skipScanComment(p, end, line); continue; }
+
+        isLineStart = false;
+
+        if (c == '"' || c == '\'')
+        {
+            p = skipScanLiteral(p, end, line);
+            previous[0] = previous[1] = '"';
+            continue;
+        }
+
+        if (c >= '0' && c <= '9')
+        {
+            // a pp-number: 0x1f, 1e+5, 1'000
+            for(p++; p < end && (isScanIdentifier(*p) == true || *p == '.' || *p == '\'' ||
+                                 ((*p == '+' || *p == '-') && strchr("eEpP", p[-1]) != nullptr)); p++) {}
+            previous[0] = previous[1] = '0';
+            continue;
+        }
+
+        if (isScanIdentifierStart(c) == true)
+        {
+            const char* start = p;
+            while(p < end && isScanIdentifier(*p) == true) p++;
+
+            std::string_view name(start, (size_t)(p - start));
+
+            if (p < end && *p == '"' && isScanRawPrefix(name) == true)
+            {
+                p = skipScanRawLiteral(p, end, line);
+                previous[0] = previous[1] = '"';
+                continue;
+            }
+
+            auto callee    = callees.find(name);
+            bool isMember  = previous[1] == '.' || (previous[0] == '-' && previous[1] == '>');
+
+            previous[0] = previous[1] = 'a';
+            if (callee == callees.end() || isMember == true) continue;
+
+            uint32_t    callLine = line;
+            const char* open     = skipScanSpaces(p, end, callLine);
+
+            // the arguments are scanned again for the nested calls
+            if (open < end && *open == '(')
+                scanCall(open, end, line, name, callee->second, isWithWarnings, findings);
+
+            continue;
+        }
+
+        previous[0] = previous[1];
+        previous[1] = c;
+        p++;
+    }
+}
+
+/** *****************************
+//  ScanCache
+//  "printfcheck-scan <options hash>" and a content hash per line, of
+//  the files without findings
+****************************** **/
+struct ScanCache
+{
+    uint64_t                     options = 0;
+    std::unordered_set<uint64_t> hashes;
+
+    void load(const char* path)
+    {
+        FILE* file = fopen(path, "r");
+        if (file == nullptr) return;
+
+        unsigned long long value = 0;
+        if (fscanf(file, "printfcheck-scan %llx", &value) == 1 && value == options)
+        {
+            while(fscanf(file, "%llx", &value) == 1) hashes.insert(value);
+        }
+
+        fclose(file);
+    }
+
+    bool save(const char* path, const std::vector<uint64_t>& clean) const
+    {
+        std::string temporary = std::string(path) + ".tmp";
+
+        FILE* file = fopen(temporary.c_str(), "w");
+        if (file == nullptr) return false;
+
+        fprintf(file, "printfcheck-scan %016llx\n", (unsigned long long)options);
+        for(uint64_t hash : clean) fprintf(file, "%016llx\n", (unsigned long long)hash);
+
+        bool isWritten = fclose(file) == 0;
+        return isWritten == true && rename(temporary.c_str(), path) == 0;
+    }
+};
+
+/** *****************************
+//  scanFiles()
+//  the threads take the files in turn, the findings are printed in the
+//  order of the files
+****************************** **/
+struct ScanFile
+{
+    std::string              path;
+    uint64_t                 hash     = 0;
+    bool                     isRead   = false;
+    bool                     isCached = false;
+    std::vector<ScanFinding> findings;
+};
+
+void
+scanFiles(std::vector<ScanFile>& files, const ScanCallees& callees, const ScanCache& cache, bool isWithWarnings, uint32_t threadCount)
+{
+    std::atomic<size_t> next { 0 };
+
+    auto worker = [&]()
+    {
+        for(size_t i = next++; i < files.size(); i = next++)
+        {
+            ScanFile&  file = files[i];
+            MappedFile source;
+
+            file.isRead = source.open(file.path.c_str());
+            if (file.isRead == false) continue;
+
+            file.hash     = hashScanFile(source.data, source.size);
+            file.isCached = cache.hashes.count(file.hash) != 0;
+
+            if (file.isCached == false) scanSource(source.data, source.size, callees, isWithWarnings, file.findings);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(uint32_t t = 1; t < threadCount; t++) threads.emplace_back(worker);
+    worker();
+    for(auto& thread : threads) thread.join();
+}
+
+bool
+isScanSourcePath(const std::filesystem::path& path)
+{
+    static const std::unordered_set<std::string> Extensions = {
+        ".c", ".cc", ".cpp", ".cxx", ".c++", ".h", ".hh", ".hpp", ".hxx", ".h++", ".inl", ".ipp", ".tcc" };
+
+    return Extensions.count(path.extension().string()) != 0;
+}
+
+// the sources of a directory, without the hidden ones like .git
+void
+findScanFiles(const char* root, std::vector<ScanFile>& files)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    if (fs::is_directory(root, error) == false)
+    {
+        files.emplace_back().path = root;
+        return;
+    }
+
+    for(auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, error);
+        it != fs::recursive_directory_iterator(); it.increment(error))
+    {
+        if (error) break;
+
+        std::string name = it->path().filename().string();
+
+        if (name.size() > 1 && name[0] == '.')
+        {
+            if (it->is_directory(error) == true) it.disable_recursion_pending();
+            continue;
+        }
+
+        if (it->is_regular_file(error) == true && isScanSourcePath(it->path()) == true)
+            files.emplace_back().path = it->path().string();
+    }
+}
+
+/** *****************************
+//  main()
+****************************** **/
+int
+usage()
+{
+    fprintf(stderr, "usage: printfcheck-scan [-j threads] [-m MACRO:fmtIndex]... [--cache file] [--warnings] paths...\n");
+    return 2;
+}
+
+int
+main(int argc, char** argv)
+{
+    ScanCallees callees = {
+        { "printf", 0 }, { "fprintf", 1 }, { "sprintf", 1 }, { "snprintf", 2 },
+        { "TRACEPRINT", 2 }, { "TRACEPRINT_FAST", 2 },
+        { "PRINTF_FAST", 0 }, { "FPRINTF_FAST", 1 }, { "SNPRINTF_FAST", 2 },
+    };
+
+    uint32_t    threadCount    = std::max(1u, std::thread::hardware_concurrency());
+    const char* cachePath      = nullptr;
+    bool        isWithWarnings = false;
+    int         index          = 1;
+
+    for(; index < argc && argv[index][0] == '-'; index++)
+    {
+        std::string_view option = argv[index];
+
+        if      (option == "--warnings")                    isWithWarnings = true;
+        else if (option == "--cache" && index + 1 < argc)   cachePath      = argv[++index];
+        else if (option == "-j" && index + 1 < argc)        threadCount    = (uint32_t)std::max(1, atoi(argv[++index]));
+        else if (option == "-m" && index + 1 < argc)
+        {
+            // the name points into argv, it lives until the end
+            std::string_view macro = argv[++index];
+            size_t           colon = macro.rfind(':');
+
+            if (colon == std::string_view::npos || colon == 0) return usage();
+            callees[macro.substr(0, colon)] = (uint32_t)atoi(argv[index] + colon + 1);
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    if (index == argc) return usage();
+
+    std::vector<ScanFile> files;
+    for(; index < argc; index++) findScanFiles(argv[index], files);
+
+    std::sort(files.begin(), files.end(), [](const ScanFile& a, const ScanFile& b) { return a.path < b.path; });
+
+    // the cache is valid for the same callees and warnings
+    std::vector<std::pair<std::string_view, uint32_t>> sorted(callees.begin(), callees.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    ScanCache cache;
+    cache.options = hashFmtFnv1a(isWithWarnings == true ? "warnings 1" : "warnings 0");
+    for(const auto& callee : sorted)
+        cache.options = hashFmtFnv1a(std::string(callee.first) + ":" + std::to_string(callee.second), cache.options);
+
+    if (cachePath != nullptr) cache.load(cachePath);
+
+    scanFiles(files, callees, cache, isWithWarnings, threadCount);
+
+    size_t                errors   = 0;
+    size_t                warnings = 0;
+    size_t                cached   = 0;
+    std::vector<uint64_t> clean;
+
+    for(const ScanFile& file : files)
+    {
+        if (file.isRead == false)
+        {
+            fprintf(stderr, "%s: can't be read\n", file.path.c_str());
+            errors++;
+            continue;
+        }
+
+        for(const ScanFinding& finding : file.findings)
+        {
+            fprintf(stdout, "%s:%u: %s\n", file.path.c_str(), finding.line, finding.text.c_str());
+            (finding.isError == true ? errors : warnings)++;
+        }
+
+        if (file.findings.empty() == true) clean.push_back(file.hash);
+        if (file.isCached == true)         cached++;
+    }
+
+    if (cachePath != nullptr && cache.save(cachePath, clean) == false)
+        fprintf(stderr, "%s: can't be written\n", cachePath);
+
+    fprintf(stderr, "%zu files, %zu cached, %zu errors, %zu warnings\n", files.size(), cached, errors, warnings);
+    return errors == 0 ? 0 : 1;
+}